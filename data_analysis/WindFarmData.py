@@ -8,14 +8,28 @@ __url__ = "https://github.com/Dennis-van-Gils/project-windfarm-practicum"
 __date__ = "14-11-2024"
 __version__ = "2.0"
 
+import json
+import mmap
 import os
+import struct
 import sys
+import zlib
 from pathlib import Path
 from tkinter import filedialog
 
 import numpy as np
 import matplotlib.pyplot as plt
 
+try:
+    import zstandard
+except ImportError:
+    zstandard = None
+
+try:
+    import lz4.frame
+except ImportError:
+    lz4 = None
+
 # plt.style.use("default")
 plt.style.use("dark_background")
 plt.rcParams["grid.color"] = "gray"
@@ -49,6 +63,17 @@ COLOR_MAP = [
 ]
 """Color map over all 6 turbines"""
 
+# Binary log file layout and codecs, must match `WindFarmBinaryLog.py` of the
+# control program. Mirrored here, together with the chunk walking of
+# `read_binary_file()`, to keep the data analysis free of the control
+# program: change both together.
+BIN_FILE_MAGIC = b"WFBL"
+BIN_FILE_HEADER = struct.Struct("<4sHI")
+BIN_CHUNK_MAGIC = b"WFCK"
+BIN_CHUNK_HEADER = struct.Struct("<4sII")
+# Compression codecs and the package each one needs
+BIN_CODECS = {"zstd": "zstandard", "lz4": "lz4", "zlib": None, "none": None}
+
 # ------------------------------------------------------------------------------
 #   WindFarmData
 # ------------------------------------------------------------------------------
@@ -59,7 +84,8 @@ class WindFarmData:
 
     Args:
         filepath (`pathlib.Path` | `str` | `None`, optional):
-            Path to the log file to open. Opens a file browser when omitted.
+            Path to the log file to open, either a text log or a binary log.
+            Opens a file browser when omitted.
 
     Main attributes:
         avg_P (`numpy.ndarray[float])`):
@@ -82,6 +108,8 @@ class WindFarmData:
     Main methods:
         read_file()
 
+        read_binary_file()
+
         quick_plot()
     """
 
@@ -135,7 +163,8 @@ class WindFarmData:
     # --------------------------------------------------------------------------
 
     def read_file(self, filepath: Path | str | None = None):
-        """Read in a log file acquired by the Wind Farm control program.
+        """Read in a log file acquired by the Wind Farm control program,
+        either a text log or a binary log as told apart by its contents.
 
         Args:
             filepath (`pathlib.Path` | `str` | `None`, optional):
@@ -143,7 +172,10 @@ class WindFarmData:
         """
         if filepath == "" or filepath is None:
             filepath = filedialog.askopenfilename(
-                filetypes=[("Text Files", "*.txt")],
+                filetypes=[
+                    ("Text Files", "*.txt"),
+                    ("Binary Log Files", "*.wfbl"),
+                ],
                 title="Open Wind Farm log file",
             )
             if filepath is None or filepath == "." or filepath == "":
@@ -159,18 +191,28 @@ class WindFarmData:
         self.filepath = f"{filepath}"
         self.filename = filepath.stem
 
-        with filepath.open() as f:
-            # The first line is expected to be the header
-            try:
-                self.header = f.readline().strip()
-            except UnicodeDecodeError as e:
-                raise TypeError("Unexpected file format.") from e
+        with filepath.open("rb") as f:
+            is_binary = f.read(len(BIN_FILE_MAGIC)) == BIN_FILE_MAGIC
 
-        # The remaining lines are expected to contain tab-delimited data values
-        try:
-            raw_data = np.loadtxt(filepath, skiprows=1, delimiter="\t")
-        except ValueError as e:
-            raise ValueError("Unexpected file format.") from e
+        if is_binary:
+            data = self.read_binary_file(filepath)
+            raw_data = np.column_stack(
+                [data["time"]]
+                + [data[f"{x}_{n}"] for n in range(1, 7) for x in ("P", "E")]
+            )
+        else:
+            with filepath.open() as f:
+                # The first line is expected to be the header
+                try:
+                    self.header = f.readline().strip()
+                except UnicodeDecodeError as e:
+                    raise TypeError("Unexpected file format.") from e
+
+            # The remaining lines are expected to contain tab-delimited data
+            try:
+                raw_data = np.loadtxt(filepath, skiprows=1, delimiter="\t")
+            except ValueError as e:
+                raise ValueError("Unexpected file format.") from e
 
         try:
             # fmt: off
@@ -217,6 +259,69 @@ class WindFarmData:
         self.std_P[4] = np.std(self.P_5)
         self.std_P[5] = np.std(self.P_6)
 
+    # --------------------------------------------------------------------------
+    #   read_binary_file
+    # --------------------------------------------------------------------------
+
+    def read_binary_file(self, filepath: Path) -> dict[str, np.ndarray]:
+        """Read in a binary log file as written by the Wind Farm control
+        program, see `WindFarmBinaryLog.py`. These hold every quantity of each
+        sensor, compressed in chunks of columns. The file gets memory-mapped,
+        so that walking the chunk headers does not read the data, and each
+        chunk gets decompressed straight into its place. An incomplete last
+        chunk, as left by a crash, gets ignored. The header describing the
+        columns and the calibration ends up in `header`.
+
+        Returns:
+            A dict mapping the column names, like `P_1`, onto the timeseries.
+        """
+        with filepath.open("rb") as f, mmap.mmap(
+            f.fileno(), 0, access=mmap.ACCESS_READ
+        ) as mm:
+            _magic, _version, header_len = BIN_FILE_HEADER.unpack_from(mm)
+            p = BIN_FILE_HEADER.size
+            header = json.loads(mm[p : p + header_len])
+            p += header_len
+
+            chunks = []  # Start of the payload, number of rows, payload length
+            while p + BIN_CHUNK_HEADER.size <= len(mm):
+                magic, n_rows, n_bytes = BIN_CHUNK_HEADER.unpack_from(mm, p)
+                p += BIN_CHUNK_HEADER.size
+                if magic != BIN_CHUNK_MAGIC or p + n_bytes > len(mm):
+                    break
+                chunks.append((p, n_rows, n_bytes))
+                p += n_bytes
+
+            codec = header["codec"]
+            if codec not in BIN_CODECS:
+                raise ValueError(f"Unknown compression codec: {codec}")
+            if (codec == "zstd" and zstandard is None) or (
+                codec == "lz4" and lz4 is None
+            ):
+                raise ImportError(
+                    f"Reading a binary log compressed with {codec} needs the "
+                    f"package `{BIN_CODECS[codec]}`."
+                )
+
+            n_fields = len(header["fields"])
+            values = np.empty((n_fields, sum(chunk[1] for chunk in chunks)))
+            row = 0
+            for start, n_rows, n_bytes in chunks:
+                payload = mm[start : start + n_bytes]
+                if codec == "zstd":
+                    payload = zstandard.ZstdDecompressor().decompress(payload)
+                elif codec == "lz4":
+                    payload = lz4.frame.decompress(payload)
+                elif codec == "zlib":
+                    payload = zlib.decompress(payload)
+                values[:, row : row + n_rows] = np.frombuffer(
+                    payload, dtype="<f8"
+                ).reshape(n_fields, n_rows)
+                row += n_rows
+
+        self.header = json.dumps(header)
+        return dict(zip(header["fields"], values))
+
     # --------------------------------------------------------------------------
     #   quick_plot
     # --------------------------------------------------------------------------
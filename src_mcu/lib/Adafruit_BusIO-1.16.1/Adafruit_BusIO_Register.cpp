@@ -191,6 +191,32 @@ uint32_t Adafruit_BusIO_Register::read(void) {
  */
 uint32_t Adafruit_BusIO_Register::readCached(void) { return _cached; }
 
+/*!
+ *    @brief  Read the register location and keep the value as the cached
+ * copy, so that readCached() also reflects a register that we did not write
+ * to ourselves yet
+ *    @return True on successful read, the cached copy is left as is otherwise
+ */
+bool Adafruit_BusIO_Register::refreshCached(void) {
+  if (!read(_buffer, _width)) {
+    return false;
+  }
+
+  uint32_t value = 0;
+
+  for (int i = 0; i < _width; i++) {
+    value <<= 8;
+    if (_byteorder == LSBFIRST) {
+      value |= _buffer[_width - i - 1];
+    } else {
+      value |= _buffer[i];
+    }
+  }
+
+  _cached = value;
+  return true;
+}
+
 /*!
  *    @brief  Read a buffer of data from the register location
  *    @param  buffer Pointer to data to read into
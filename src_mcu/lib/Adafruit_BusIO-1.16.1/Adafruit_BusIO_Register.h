@@ -62,6 +62,7 @@ public:
   bool read(uint16_t *value);
   uint32_t read(void);
   uint32_t readCached(void);
+  bool refreshCached(void);
   bool write(uint8_t *buffer, uint8_t len);
   bool write(uint32_t value, uint8_t numbytes = 0);
 
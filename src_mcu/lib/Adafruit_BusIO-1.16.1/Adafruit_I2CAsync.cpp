@@ -0,0 +1,190 @@
+#include "Adafruit_I2CAsync.h"
+
+#if defined(__SAMD51__)
+
+// I2C master bus states as reported by STATUS.BUSSTATE
+#define I2CM_BUSSTATE_IDLE 1
+#define I2CM_BUSSTATE_OWNER 2
+
+// I2C master commands for CTRLB.CMD
+#define I2CM_CMD_READ 2
+#define I2CM_CMD_STOP 3
+
+/*!
+ *    @brief  Create a non-blocking transfer engine on top of a SERCOM that has
+ * already been set up as I2C master, typically by `Wire.begin()`. The engine
+ * sequences START, repeated START, ACK/NACK and STOP in the same way as the
+ * blocking `TwoWire` implementation, but returns to the caller while the
+ * SERCOM is shifting bits instead of spinning on its flags. Do not use the
+ * blocking `Adafruit_I2CDevice` API on the same bus while busy().
+ *    @param  sercom The SERCOM peripheral of the bus, e.g. SERCOM2 for `Wire`
+ * on the Feather M4 and ItsyBitsy M4
+ */
+Adafruit_I2CAsync::Adafruit_I2CAsync(Sercom *sercom) {
+  _sercom = sercom;
+  _state = IDLE;
+  _jobs = nullptr;
+  _n_jobs = 0;
+  _i_job = 0;
+  _pos = 0;
+  _success = true;
+  _callback = nullptr;
+  _context = nullptr;
+}
+
+/*!
+ *    @brief  Queue a batch of register reads to run back to back. The jobs
+ * array and destination buffers must stay valid until the batch finished.
+ *    @param  jobs Array of jobs
+ *    @param  n_jobs Number of jobs in the array
+ *    @param  callback Optional function called from poll() when the batch
+ * finished
+ *    @param  context Optional pointer passed on to the callback
+ *    @return True if the batch got queued, false when still busy
+ */
+bool Adafruit_I2CAsync::submit(const Adafruit_I2CAsyncJob *jobs,
+                               uint8_t n_jobs,
+                               Adafruit_I2CAsyncCallback callback,
+                               void *context) {
+  if (busy()) {
+    return false;
+  }
+
+  _jobs = jobs;
+  _n_jobs = n_jobs;
+  _i_job = 0;
+  _callback = callback;
+  _context = context;
+
+  if (n_jobs == 0) {
+    _finish(true);
+    return true;
+  }
+
+  _state = WAIT_BUS;
+  poll();
+  return true;
+}
+
+/*!
+ *    @brief  Advance the transfer as far as the SERCOM allows without waiting.
+ * Call this frequently, e.g. on every pass of `loop()`. The bus is held with
+ * clock stretching in between calls, so calling it less often only slows the
+ * transfer down.
+ *    @return True while the batch is still in progress
+ */
+bool Adafruit_I2CAsync::poll(void) {
+  SercomI2cm &i2c = _sercom->I2CM;
+
+  while (_state != IDLE) {
+    const Adafruit_I2CAsyncJob &job = _jobs[_i_job];
+
+    if ((_state != WAIT_BUS) &&
+        (i2c.STATUS.bit.BUSERR || i2c.STATUS.bit.ARBLOST)) {
+      _command(I2CM_CMD_STOP);
+      _finish(false);
+      break;
+    }
+
+    switch (_state) {
+      case WAIT_BUS:
+        if ((i2c.STATUS.bit.BUSSTATE != I2CM_BUSSTATE_IDLE) &&
+            (i2c.STATUS.bit.BUSSTATE != I2CM_BUSSTATE_OWNER)) {
+          return true;
+        }
+        _startJob();
+        break;
+
+      case ADDR_W:
+        if (!i2c.INTFLAG.bit.MB) {
+          return true;
+        }
+        if (i2c.STATUS.bit.RXNACK) {
+          _command(I2CM_CMD_STOP);
+          _finish(false);
+          break;
+        }
+        i2c.DATA.bit.DATA = job.reg;
+        _state = REG_W;
+        break;
+
+      case REG_W:
+        if (!i2c.INTFLAG.bit.MB) {
+          return true;
+        }
+        if (i2c.STATUS.bit.RXNACK) {
+          _command(I2CM_CMD_STOP);
+          _finish(false);
+          break;
+        }
+        // Repeated start in read direction
+        _pos = 0;
+        i2c.ADDR.bit.ADDR = (job.addr << 1) | 1;
+        _state = READ;
+        break;
+
+      case READ:
+        if (!i2c.INTFLAG.bit.SB) {
+          if (i2c.INTFLAG.bit.MB) {
+            // The device NACKed its address
+            _command(I2CM_CMD_STOP);
+            _finish(false);
+            break;
+          }
+          return true;
+        }
+        job.dest[_pos++] = i2c.DATA.bit.DATA;
+        if (_pos < job.len) {
+          i2c.CTRLB.bit.ACKACT = 0;
+          _command(I2CM_CMD_READ);
+        } else {
+          i2c.CTRLB.bit.ACKACT = 1;
+          _command(I2CM_CMD_STOP);
+          if (++_i_job < _n_jobs) {
+            _state = WAIT_BUS;
+          } else {
+            _finish(true);
+          }
+        }
+        break;
+
+      default:
+        break;
+    }
+  }
+
+  return false;
+}
+
+/*!
+ *    @brief  Send START plus address in write direction for the current job
+ */
+void Adafruit_I2CAsync::_startJob(void) {
+  _sercom->I2CM.ADDR.bit.ADDR = _jobs[_i_job].addr << 1;
+  _state = ADDR_W;
+}
+
+/*!
+ *    @brief  End the batch and notify the callback
+ *    @param  success Whether all jobs succeeded
+ */
+void Adafruit_I2CAsync::_finish(bool success) {
+  _success = success;
+  _state = IDLE;
+  if (_callback) {
+    _callback(success, _context);
+  }
+}
+
+/*!
+ *    @brief  Issue a bus command and wait for it to synchronize, which takes
+ * a few peripheral clock cycles only
+ *    @param  cmd Command for CTRLB.CMD
+ */
+void Adafruit_I2CAsync::_command(uint8_t cmd) {
+  _sercom->I2CM.CTRLB.bit.CMD = cmd;
+  while (_sercom->I2CM.SYNCBUSY.bit.SYSOP) {
+  }
+}
+
+#endif // __SAMD51__
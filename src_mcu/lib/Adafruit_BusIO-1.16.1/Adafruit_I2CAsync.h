@@ -0,0 +1,73 @@
+#ifndef Adafruit_I2CAsync_h
+#define Adafruit_I2CAsync_h
+
+#include <Arduino.h>
+
+/*!
+ * @brief A single register read: write the register pointer, then read `len`
+ * bytes after a repeated start
+ */
+typedef struct {
+  uint8_t addr;  ///< 7-bit I2C address of the device
+  uint8_t reg;   ///< Register pointer to write before reading
+  uint8_t len;   ///< Number of bytes to read
+  uint8_t *dest; ///< Buffer receiving the `len` bytes
+} Adafruit_I2CAsyncJob;
+
+/*!
+ * @brief Completion callback, invoked from poll() once all jobs of a batch
+ * have finished or one of them failed
+ */
+typedef void (*Adafruit_I2CAsyncCallback)(bool success, void *context);
+
+#if defined(__SAMD51__)
+
+///< Non-blocking I2C master transfer engine driving a SAMD51 SERCOM directly
+class Adafruit_I2CAsync {
+public:
+  Adafruit_I2CAsync(Sercom *sercom);
+
+  bool submit(const Adafruit_I2CAsyncJob *jobs, uint8_t n_jobs,
+              Adafruit_I2CAsyncCallback callback = nullptr,
+              void *context = nullptr);
+  bool poll(void);
+
+  /*!   @brief  Whether a batch of jobs is still in progress
+   *    @return True when busy */
+  bool busy(void) { return _state != IDLE; }
+
+  /*!   @brief  Outcome of the last finished batch
+   *    @return True if all jobs of the last batch succeeded */
+  bool success(void) { return _success; }
+
+  /*!   @brief  Number of jobs of the last finished batch that completed,
+   * which is the index of the failed job when it did not succeed
+   *    @return Number of completed jobs */
+  uint8_t completed(void) { return _i_job; }
+
+private:
+  enum State {
+    IDLE,      ///< No batch in progress
+    WAIT_BUS,  ///< Waiting for the bus to become idle to START the next job
+    ADDR_W,    ///< Address + write sent, waiting for ACK
+    REG_W,     ///< Register pointer sent, waiting for ACK
+    READ,      ///< Repeated start + address + read sent, receiving bytes
+  };
+
+  void _startJob(void);
+  void _finish(bool success);
+  void _command(uint8_t cmd);
+
+  Sercom *_sercom;
+  volatile State _state;
+  const Adafruit_I2CAsyncJob *_jobs;
+  uint8_t _n_jobs;
+  uint8_t _i_job;
+  uint8_t _pos;
+  bool _success;
+  Adafruit_I2CAsyncCallback _callback;
+  void *_context;
+};
+
+#endif // __SAMD51__
+#endif // Adafruit_I2CAsync_h
@@ -33,6 +33,7 @@
 
 #include "Arduino.h"
 #include <Wire.h>
+#include <new>
 
 #include "Adafruit_INA228.h"
 
@@ -54,60 +55,171 @@ Adafruit_INA228::Adafruit_INA228(void) {}
  */
 bool Adafruit_INA228::begin(uint8_t i2c_address, TwoWire *theWire,
                             bool skipReset) {
-  i2c_dev = new Adafruit_I2CDevice(i2c_address, theWire);
+  // The device and registers live in storage inside this object, so that no
+  // heap gets used and begin() may be called again to re-probe the chip
+  i2c_dev = new (_i2c_dev_storage) Adafruit_I2CDevice(i2c_address, theWire);
+
+  // Placed before probing, so that a chip that is absent can still be
+  // configured and read without crashing: the transfers merely fail
+  Config = _placeRegister(0, INA228_REG_CONFIG, 2);
+  ADC_Config = _placeRegister(1, INA228_REG_ADCCFG, 2);
+  Diag_Alert = _placeRegister(2, INA228_REG_DIAGALRT, 2);
+  Current = _placeRegister(3, INA228_REG_CURRENT, 3);
+  Bus_Voltage = _placeRegister(4, INA228_REG_VBUS, 3);
+  Energy = _placeRegister(5, INA228_REG_ENERGY, 5);
+  Shunt_Cal = _placeRegister(6, INA228_REG_SHUNTCAL, 2);
+  Power = _placeRegister(7, INA228_REG_POWER, 3);
+  Die_Temp = _placeRegister(8, INA228_REG_DIETEMP, 2);
+  Charge = _placeRegister(9, INA228_REG_CHARGE, 5);
 
   if (!i2c_dev->begin()) {
     return false;
   }
 
-  Adafruit_I2CRegister *device_register =
-      new Adafruit_I2CRegister(i2c_dev, INA228_REG_DVC_UID, 2, MSBFIRST);
-  Adafruit_I2CRegister *mfg_register =
-      new Adafruit_I2CRegister(i2c_dev, INA228_REG_MFG_UID, 2, MSBFIRST);
-  Adafruit_I2CRegisterBits *device_id =
-      new Adafruit_I2CRegisterBits(device_register, 12, 4);
+  Adafruit_I2CRegister device_register =
+      Adafruit_I2CRegister(i2c_dev, INA228_REG_DVC_UID, 2, MSBFIRST);
+  Adafruit_I2CRegister mfg_register =
+      Adafruit_I2CRegister(i2c_dev, INA228_REG_MFG_UID, 2, MSBFIRST);
+  Adafruit_I2CRegisterBits device_id =
+      Adafruit_I2CRegisterBits(&device_register, 12, 4);
 
   // make sure we're talking to the right chip
-  if ((mfg_register->read() != 0x5449) || (device_id->read() != 0x228)) {
+  if ((mfg_register.read() != 0x5449) || (device_id.read() != 0x228)) {
     return false;
   }
 
-  Config = new Adafruit_I2CRegister(i2c_dev, INA228_REG_CONFIG, 2, MSBFIRST);
-  ADC_Config =
-      new Adafruit_I2CRegister(i2c_dev, INA228_REG_ADCCFG, 2, MSBFIRST);
-  Diag_Alert =
-      new Adafruit_I2CRegister(i2c_dev, INA228_REG_DIAGALRT, 2, MSBFIRST);
-
   if (!skipReset) {
     reset();
     delay(2); // delay 2ms to give time for first measurement to finish
+  } else if (!resync()) {
+    return false;
   }
   return true;
 }
 /**************************************************************************/
+/*!
+    @brief Constructs a BusIO register of this chip in its preallocated slot
+    @param slot
+           Index into the register storage, below _N_REGISTERS
+    @param reg_addr
+           Register address
+    @param width
+           Register width in bytes
+    @return The register
+*/
+/**************************************************************************/
+Adafruit_I2CRegister *Adafruit_INA228::_placeRegister(uint8_t slot,
+                                                      uint16_t reg_addr,
+                                                      uint8_t width) {
+  return new (_register_storage[slot])
+      Adafruit_I2CRegister(i2c_dev, reg_addr, width, MSBFIRST);
+}
+/**************************************************************************/
+/*!
+    @brief Reloads the RAM copies of the CONFIG, ADC_CONFIG and SHUNT_CAL
+    registers from the chip. These configuration registers only change by
+    our own writes, so after begin() their getters are served from RAM and
+    their setters only write when the value changes. Call this when the
+    chip got reset or reconfigured behind our back, e.g. by a power glitch.
+    @return True on success
+*/
+/**************************************************************************/
+bool Adafruit_INA228::resync(void) {
+  return Config->refreshCached() && ADC_Config->refreshCached() &&
+         Shunt_Cal->refreshCached();
+}
+/**************************************************************************/
 /*!
     @brief Resets the harware. All registers are set to default values,
     the same as a power-on reset.
 */
 /**************************************************************************/
 void Adafruit_INA228::reset(void) {
-  Adafruit_I2CRegisterBits reset = Adafruit_I2CRegisterBits(Config, 1, 15);
-  reset.write(1);
+  _strobeConfigBit(15);
+  resync();
   Adafruit_I2CRegisterBits alert_conv =
       Adafruit_I2CRegisterBits(Diag_Alert, 1, 14);
   alert_conv.write(1);
   setMode(INA228_MODE_CONTINUOUS);
 }
 /**************************************************************************/
+/*!
+    @brief Sets the clock of the I2C bus this chip is on, affecting all
+    other devices on that bus too. The INA228 supports up to 2.94 MHz.
+    Call after begin(), which resets the clock to the default.
+    @param clock
+           The I2C clock in Hz
+    @return True on success
+*/
+/**************************************************************************/
+bool Adafruit_INA228::setI2CSpeed(uint32_t clock) {
+  return i2c_dev->setSpeed(clock);
+}
+/**************************************************************************/
 /*!
     @brief Resets the energy and charge accumulators of the INA228 chip
     to 0.
 */
 /**************************************************************************/
-void Adafruit_INA228::resetAccumulators(void) {
-  Adafruit_I2CRegisterBits reset_accumulators =
-      Adafruit_I2CRegisterBits(Config, 1, 14);
-  reset_accumulators.write(1);
+void Adafruit_INA228::resetAccumulators(void) { _strobeConfigBit(14); }
+
+/**************************************************************************/
+/*!
+    @brief Sets a self-clearing bit of the CONFIG register, leaving the RAM
+    copy of CONFIG untouched so that the bit does not get written again by
+    later configuration changes.
+    @param bit
+           Bit position, 15 (RST) or 14 (RSTACC)
+*/
+/**************************************************************************/
+void Adafruit_INA228::_strobeConfigBit(uint8_t bit) {
+  Adafruit_I2CRegister config =
+      Adafruit_I2CRegister(i2c_dev, INA228_REG_CONFIG, 2, MSBFIRST);
+  config.write(Config->readCached() | (1UL << bit));
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads a slice of bits from the RAM copy of a configuration
+    register, see resync().
+    @param reg
+           Config, ADC_Config or Shunt_Cal
+    @param bits
+           Number of bits in the slice
+    @param shift
+           Position of the lowest bit of the slice
+    @return The bits
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA228::_readShadowBits(Adafruit_I2CRegister *reg,
+                                          uint8_t bits, uint8_t shift) {
+  return (reg->readCached() >> shift) & ((1UL << bits) - 1);
+}
+
+/**************************************************************************/
+/*!
+    @brief Changes a slice of bits of a configuration register, sending the
+    register to the chip only when its value changes, see resync().
+    @param reg
+           Config, ADC_Config or Shunt_Cal
+    @param bits
+           Number of bits in the slice
+    @param shift
+           Position of the lowest bit of the slice
+    @param value
+           The new bits
+    @return True on success
+*/
+/**************************************************************************/
+bool Adafruit_INA228::_writeShadowBits(Adafruit_I2CRegister *reg, uint8_t bits,
+                                       uint8_t shift, uint32_t value) {
+  uint32_t mask = ((1UL << bits) - 1) << shift;
+  uint32_t old_value = reg->readCached();
+  uint32_t new_value = (old_value & ~mask) | ((value << shift) & mask);
+  if (new_value == old_value) {
+    return true;
+  }
+  return reg->write(new_value);
 }
 
 /**************************************************************************/
@@ -120,11 +232,9 @@ void Adafruit_INA228::_updateShuntCalRegister() {
   if (getADCRange()) {
     scale = 4;
   }
-  float shunt_cal = 13107.2 * 1000000.0 * _shunt_res * _current_lsb * scale;
+  float shunt_cal = 13107.2e6f * _shunt_res * _current_lsb * scale;
 
-  Adafruit_I2CRegister shunt =
-      Adafruit_I2CRegister(i2c_dev, INA228_REG_SHUNTCAL, 2, MSBFIRST);
-  shunt.write(shunt_cal);
+  _writeShadowBits(Shunt_Cal, 16, 0, shunt_cal);
 }
 
 /**************************************************************************/
@@ -137,6 +247,8 @@ void Adafruit_INA228::_updateShuntCalRegister() {
 void Adafruit_INA228::setShunt(float shunt_res, float max_current) {
   _shunt_res = shunt_res;
   _current_lsb = max_current / (float)(1UL << 19);
+  _energy_lsb = 16 * 3.2f * _current_lsb;
+  _max_current_uA = lroundf(max_current * 1e6f);
   _updateShuntCalRegister();
 }
 
@@ -148,19 +260,38 @@ void Adafruit_INA228::setShunt(float shunt_res, float max_current) {
 */
 /**************************************************************************/
 void Adafruit_INA228::setADCRange(uint8_t adc_range) {
-  Adafruit_I2CRegisterBits adc_range_bit =
-      Adafruit_I2CRegisterBits(Config, 1, 4);
-  adc_range_bit.write(adc_range);
+  _writeShadowBits(Config, 1, 4, adc_range);
   _updateShuntCalRegister();
 }
 
+/**************************************************************************/
+/*!
+    @brief Sets the shunt resistance, the current LSB and the shunt full
+    scale ADC range in one go, writing CONFIG and SHUNT_CAL at most once
+    each and not at all when they already hold the wanted values. Unlike
+    calling setShunt() and setADCRange() in turn, which may write SHUNT_CAL
+    twice.
+    @param shunt_res Resistance of the shunt in ohms (floating point)
+    @param max_current Maximum expected current in A (floating point)
+    @param adc_range
+           Shunt full scale ADC range (0: +/-163.84 mV or 1: +/-40.96 mV)
+*/
+/**************************************************************************/
+void Adafruit_INA228::setCalibration(float shunt_res, float max_current,
+                                     uint8_t adc_range) {
+  _writeShadowBits(Config, 1, 4, adc_range);
+  setShunt(shunt_res, max_current);
+}
+
 /**************************************************************************/
 /*!
     @brief Reads the shunt full scale ADC range across IN+ and IN-.
     @return Shunt full scale ADC range (0: +/-163.84 mV or 1: +/-40.96 mV)
 */
 /**************************************************************************/
-uint8_t Adafruit_INA228::getADCRange() { return (Config->read() >> 4) & 1; }
+uint8_t Adafruit_INA228::getADCRange() {
+  return _readShadowBits(Config, 1, 4);
+}
 
 /**************************************************************************/
 /*!
@@ -169,10 +300,8 @@ uint8_t Adafruit_INA228::getADCRange() { return (Config->read() >> 4) & 1; }
 */
 /**************************************************************************/
 float Adafruit_INA228::readDieTemp(void) {
-  Adafruit_I2CRegister temp =
-      Adafruit_I2CRegister(i2c_dev, INA228_REG_DIETEMP, 2, MSBFIRST);
-  int16_t t = temp.read();
-  return (float)t * 7.8125 / 1000.0;
+  Die_Temp->read(_buffer + 14, 2);
+  return (float)_unpackDieTemp() * 7.8125e-3f;
 }
 /**************************************************************************/
 /*!
@@ -181,12 +310,7 @@ float Adafruit_INA228::readDieTemp(void) {
 */
 /**************************************************************************/
 float Adafruit_INA228::readCurrent(void) {
-  Adafruit_I2CRegister current =
-      Adafruit_I2CRegister(i2c_dev, INA228_REG_CURRENT, 3, MSBFIRST);
-  int32_t i = current.read();
-  if (i & 0x800000)
-    i |= 0xFF000000;
-  return (float)i / 16.0 * _current_lsb * 1000.0;
+  return (float)readCurrentRaw() * _current_lsb * 1000.0f;
 }
 /**************************************************************************/
 /*!
@@ -195,10 +319,7 @@ float Adafruit_INA228::readCurrent(void) {
 */
 /**************************************************************************/
 float Adafruit_INA228::readBusVoltage(void) {
-
-  Adafruit_I2CRegister bus_voltage =
-      Adafruit_I2CRegister(i2c_dev, INA228_REG_VBUS, 3, MSBFIRST);
-  return (float)((uint32_t)bus_voltage.read() >> 4) * 195.3125 / 1000.0;
+  return (float)readBusVoltageRaw() * 0.1953125f;
 }
 
 /**************************************************************************/
@@ -208,9 +329,9 @@ float Adafruit_INA228::readBusVoltage(void) {
 */
 /**************************************************************************/
 float Adafruit_INA228::readShuntVoltage(void) {
-  float scale = 312.5;
+  float scale = 312.5f;
   if (getADCRange()) {
-    scale = 78.125;
+    scale = 78.125f;
   }
 
   Adafruit_I2CRegister shunt_voltage =
@@ -218,7 +339,7 @@ float Adafruit_INA228::readShuntVoltage(void) {
   int32_t v = shunt_voltage.read();
   if (v & 0x800000)
     v |= 0xFF000000;
-  return (float)v / 16.0 * scale / 1000000.0;
+  return (float)(v >> 4) * scale * 1e-6f;
 }
 
 /**************************************************************************/
@@ -228,9 +349,8 @@ float Adafruit_INA228::readShuntVoltage(void) {
 */
 /**************************************************************************/
 float Adafruit_INA228::readPower(void) {
-  Adafruit_I2CRegister power =
-      Adafruit_I2CRegister(i2c_dev, INA228_REG_POWER, 3, MSBFIRST);
-  return (float)power.read() * 3.2 * _current_lsb * 1000;
+  Power->read(_buffer + 11, 3);
+  return (float)_unpackPower() * 3.2f * _current_lsb * 1000.0f;
 }
 
 /**************************************************************************/
@@ -240,16 +360,410 @@ float Adafruit_INA228::readPower(void) {
 */
 /**************************************************************************/
 float Adafruit_INA228::readEnergy(void) {
-  Adafruit_I2CRegister energy =
-      Adafruit_I2CRegister(i2c_dev, INA228_REG_ENERGY, 5, MSBFIRST);
-  uint8_t buff[5];
-  energy.read(buff, 5);
-  float e = 0;
-  for (int i = 0; i < 5; i++) {
-    e *= 256;
-    e += buff[i];
+  return (float)readEnergyRaw() * _energy_lsb;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads and scales the current value of the Charge register.
+    @return The current Charge calculation in Coulombs
+*/
+/**************************************************************************/
+float Adafruit_INA228::readCharge(void) {
+  return (float)readChargeRaw() * _current_lsb;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the Current register and scales it using integer math only.
+    @return The current measurement in uA
+*/
+/**************************************************************************/
+int32_t Adafruit_INA228::readCurrent_uA(void) {
+  return currentRawTo_uA(readCurrentRaw());
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the Bus Voltage register and scales it using integer math
+    only.
+    @return The bus voltage measurement in uV
+*/
+/**************************************************************************/
+int32_t Adafruit_INA228::readBusVoltage_uV(void) {
+  return busVoltageRawTo_uV(readBusVoltageRaw());
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the Energy register and scales it using integer math only,
+    so that no precision is lost on long runs.
+    @return The energy accumulated since the last reset in uJ
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA228::readEnergy_uJ(void) {
+  return energyRawTo_uJ(readEnergyRaw());
+}
+
+/**************************************************************************/
+/*!
+    @brief Scales a raw Current register count, rounding to the nearest uA.
+    @param current_raw
+           Sign-extended 20-bit count as returned by readCurrentRaw()
+    @return The current in uA
+*/
+/**************************************************************************/
+int32_t Adafruit_INA228::currentRawTo_uA(int32_t current_raw) {
+  return ((int64_t)current_raw * _max_current_uA + (1L << 18)) >> 19;
+}
+
+/**************************************************************************/
+/*!
+    @brief Scales a raw Bus Voltage register count, rounding to the nearest
+    uV.
+    @param bus_voltage_raw
+           20-bit count as returned by readBusVoltageRaw()
+    @return The bus voltage in uV
+*/
+/**************************************************************************/
+int32_t Adafruit_INA228::busVoltageRawTo_uV(uint32_t bus_voltage_raw) {
+  return (bus_voltage_raw * INA228_VBUS_LSB_NUM +
+          (1UL << (INA228_VBUS_LSB_SHIFT - 1))) >>
+         INA228_VBUS_LSB_SHIFT;
+}
+
+/**************************************************************************/
+/*!
+    @brief Scales a raw Energy register count, truncating to whole uJ. Exact
+    over the full 40-bit range for a maximum current of up to 16 A.
+    @param energy_raw
+           40-bit count as returned by readEnergyRaw()
+    @return The energy in uJ
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA228::energyRawTo_uJ(uint64_t energy_raw) {
+  return energy_raw * (uint32_t)_max_current_uA / INA228_ENERGY_LSB_DIV;
+}
+
+/**************************************************************************/
+/*!
+    @brief Scales a raw Charge register count, truncating to whole uC. Exact
+    over the full 40-bit range for a maximum current of up to 16 A.
+    @param charge_raw
+           Sign-extended 40-bit count as returned by readChargeRaw()
+    @return The charge in uC
+*/
+/**************************************************************************/
+int64_t Adafruit_INA228::chargeRawTo_uC(int64_t charge_raw) {
+  return charge_raw * _max_current_uA / (1L << 19);
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the unscaled value of the Current register.
+    @return The 20-bit two's complement current register value, sign-extended.
+            Multiply by the current LSB to get the current in A.
+*/
+/**************************************************************************/
+int32_t Adafruit_INA228::readCurrentRaw(void) {
+  Current->read(_buffer, 3);
+  return _unpackCurrent();
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the unscaled value of the Bus Voltage register.
+    @return The 20-bit bus voltage register value. One count equals
+            195.3125 uV.
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA228::readBusVoltageRaw(void) {
+  Bus_Voltage->read(_buffer + 3, 3);
+  return _unpackBusVoltage();
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the unscaled value of the Energy register.
+    @return The 40-bit energy accumulator. Multiply by 16 * 3.2 times the
+            current LSB to get the energy in Joules.
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA228::readEnergyRaw(void) {
+  Energy->read(_buffer + 6, 5);
+  return _unpackEnergy();
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the unscaled value of the Charge register.
+    @return The 40-bit two's complement charge accumulator, sign-extended.
+            Multiply by the current LSB to get the charge in Coulombs.
+*/
+/**************************************************************************/
+int64_t Adafruit_INA228::readChargeRaw(void) {
+  Charge->read(_buffer + 16, 5);
+  return _unpackCharge();
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the selected result registers in one go, using the
+    preallocated result registers and receive buffer. Each register costs a
+    single pointer write followed by a repeated-start read.
+    @param meas
+           Receives the raw register counts and the scaled values
+    @param channels
+           Bitmask of INA228_Channel values selecting the registers
+    @return True if all registers were read successfully, otherwise false.
+            The contents of `meas` are undefined on failure.
+*/
+/**************************************************************************/
+bool Adafruit_INA228::readMeasurement(INA228_Measurement &meas,
+                                      uint8_t channels) {
+  if (((channels & INA228_CH_CURRENT) && !Current->read(_buffer, 3)) ||
+      ((channels & INA228_CH_BUS_VOLTAGE) &&
+       !Bus_Voltage->read(_buffer + 3, 3)) ||
+      ((channels & INA228_CH_ENERGY) && !Energy->read(_buffer + 6, 5)) ||
+      ((channels & INA228_CH_POWER) && !Power->read(_buffer + 11, 3)) ||
+      ((channels & INA228_CH_DIE_TEMP) && !Die_Temp->read(_buffer + 14, 2)) ||
+      ((channels & INA228_CH_CHARGE) && !Charge->read(_buffer + 16, 5))) {
+    return false;
+  }
+  decodeMeasurement(meas, channels);
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Describes the register reads of readMeasurement() as jobs for the
+    non-blocking Adafruit_I2CAsync engine. The jobs target the internal
+    receive buffer; call decodeMeasurement() once they have completed.
+    @param jobs
+           Array receiving the jobs, must have room for one entry per
+           selected channel
+    @param channels
+           Bitmask of INA228_Channel values selecting the registers
+    @return The number of jobs written
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA228::measurementJobs(Adafruit_I2CAsyncJob *jobs,
+                                         uint8_t channels) {
+  uint8_t addr = i2c_dev->address();
+  uint8_t n = 0;
+  if (channels & INA228_CH_CURRENT) {
+    jobs[n++] = {addr, INA228_REG_CURRENT, 3, _buffer};
+  }
+  if (channels & INA228_CH_BUS_VOLTAGE) {
+    jobs[n++] = {addr, INA228_REG_VBUS, 3, _buffer + 3};
+  }
+  if (channels & INA228_CH_ENERGY) {
+    jobs[n++] = {addr, INA228_REG_ENERGY, 5, _buffer + 6};
+  }
+  if (channels & INA228_CH_POWER) {
+    jobs[n++] = {addr, INA228_REG_POWER, 3, _buffer + 11};
+  }
+  if (channels & INA228_CH_DIE_TEMP) {
+    jobs[n++] = {addr, INA228_REG_DIETEMP, 2, _buffer + 14};
+  }
+  if (channels & INA228_CH_CHARGE) {
+    jobs[n++] = {addr, INA228_REG_CHARGE, 5, _buffer + 16};
+  }
+  return n;
+}
+
+/**************************************************************************/
+/*!
+    @brief Decodes and scales the internal receive buffer as filled by
+    readMeasurement() or by the jobs of measurementJobs().
+    @param meas
+           Receives the raw register counts and the scaled values
+    @param channels
+           Bitmask of INA228_Channel values selecting the registers
+*/
+/**************************************************************************/
+void Adafruit_INA228::decodeMeasurement(INA228_Measurement &meas,
+                                        uint8_t channels) {
+  if (channels & INA228_CH_CURRENT) {
+    meas.current_raw = _unpackCurrent();
+    meas.current = (float)meas.current_raw * _current_lsb * 1000.0f;
+  }
+  if (channels & INA228_CH_BUS_VOLTAGE) {
+    meas.bus_voltage_raw = _unpackBusVoltage();
+    meas.bus_voltage = (float)meas.bus_voltage_raw * 0.1953125f;
+  }
+  if (channels & INA228_CH_ENERGY) {
+    meas.energy_raw = _unpackEnergy();
+    meas.energy = (float)meas.energy_raw * _energy_lsb;
+  }
+  if (channels & INA228_CH_POWER) {
+    meas.power_raw = _unpackPower();
+    meas.power = (float)meas.power_raw * 3.2f * _current_lsb * 1000.0f;
+  }
+  if (channels & INA228_CH_DIE_TEMP) {
+    meas.die_temp_raw = _unpackDieTemp();
+    meas.die_temp = (float)meas.die_temp_raw * 7.8125e-3f;
+  }
+  if (channels & INA228_CH_CHARGE) {
+    meas.charge_raw = _unpackCharge();
+    meas.charge = (float)meas.charge_raw * _current_lsb;
   }
-  return (float)e * 16 * 3.2 * _current_lsb;
+}
+
+/**************************************************************************/
+/*!
+    @brief Reads the selected result registers such that all of them stem
+    from the same conversion cycle. The INA228 does not auto-increment its
+    register pointer, so the registers still get read one by one and a
+    conversion finishing halfway would mix two cycles. Therefore the
+    conversion-ready flag gets cleared before and checked after the reads.
+    When it got set in between the registers get read once more, now with a
+    whole conversion period to spare, and checked again. Costs two or three
+    reads of DIAG_ALRT on top of readMeasurement(), and clears its flags.
+    @param meas
+           Receives the raw register counts and the scaled values
+    @param channels
+           Bitmask of INA228_Channel values selecting the registers
+    @param coherent
+           Optionally receives whether the last attempt stems from a single
+           conversion cycle. It does not when the registers take longer to
+           read than a conversion period.
+    @return True if all registers were read successfully, otherwise false.
+            The contents of `meas` are undefined on failure.
+*/
+/**************************************************************************/
+bool Adafruit_INA228::readSnapshot(INA228_Measurement &meas, uint8_t channels,
+                                   bool *coherent) {
+  if (!Diag_Alert->read(_buffer + 21, 2)) {
+    return false;
+  }
+  bool ok = false;
+  for (uint8_t attempt = 0; attempt < 2; attempt++) {
+    if (!readMeasurement(meas, channels) ||
+        !Diag_Alert->read(_buffer + 21, 2)) {
+      return false;
+    }
+    ok = snapshotCoherent();
+    if (ok) {
+      break;
+    }
+  }
+  if (coherent) {
+    *coherent = ok;
+  }
+  return true;
+}
+
+/**************************************************************************/
+/*!
+    @brief Describes the register reads of readSnapshot() as jobs for the
+    non-blocking Adafruit_I2CAsync engine: the jobs of measurementJobs()
+    between two reads of DIAG_ALRT. There is no second attempt; call
+    snapshotCoherent() once they have completed.
+    @param jobs
+           Array receiving the jobs, must have room for one entry per
+           selected channel plus two
+    @param channels
+           Bitmask of INA228_Channel values selecting the registers
+    @return The number of jobs written
+*/
+/**************************************************************************/
+uint8_t Adafruit_INA228::snapshotJobs(Adafruit_I2CAsyncJob *jobs,
+                                      uint8_t channels) {
+  uint8_t addr = i2c_dev->address();
+  jobs[0] = {addr, INA228_REG_DIAGALRT, 2, _buffer + 21};
+  uint8_t n = 1 + measurementJobs(jobs + 1, channels);
+  jobs[n++] = {addr, INA228_REG_DIAGALRT, 2, _buffer + 21};
+  return n;
+}
+
+/**************************************************************************/
+/*!
+    @brief Tells whether the registers of the last readSnapshot() or of the
+    jobs of snapshotJobs() stem from a single conversion cycle, i.e. the
+    conversion-ready flag did not get set while reading them.
+    @return True if coherent
+*/
+/**************************************************************************/
+bool Adafruit_INA228::snapshotCoherent(void) {
+  return !(_buffer[22] & 0x02); // CNVRF, bit 1 of DIAG_ALRT
+}
+
+/**************************************************************************/
+/*!
+    @brief Decodes the CURRENT slice of the receive buffer.
+    @return The 20-bit two's complement value, sign-extended
+*/
+/**************************************************************************/
+int32_t Adafruit_INA228::_unpackCurrent(void) {
+  int32_t i = ((uint32_t)_buffer[0] << 16) | ((uint32_t)_buffer[1] << 8) |
+              _buffer[2];
+  if (i & 0x800000)
+    i |= 0xFF000000;
+  return i >> 4;
+}
+
+/**************************************************************************/
+/*!
+    @brief Decodes the VBUS slice of the receive buffer.
+    @return The 20-bit unsigned value
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA228::_unpackBusVoltage(void) {
+  return (((uint32_t)_buffer[3] << 16) | ((uint32_t)_buffer[4] << 8) |
+          _buffer[5]) >>
+         4;
+}
+
+/**************************************************************************/
+/*!
+    @brief Decodes the ENERGY slice of the receive buffer.
+    @return The 40-bit unsigned value
+*/
+/**************************************************************************/
+uint64_t Adafruit_INA228::_unpackEnergy(void) {
+  uint64_t e = 0;
+  for (int i = 6; i < 11; i++) {
+    e = (e << 8) | _buffer[i];
+  }
+  return e;
+}
+
+/**************************************************************************/
+/*!
+    @brief Decodes the POWER slice of the receive buffer.
+    @return The 24-bit unsigned value
+*/
+/**************************************************************************/
+uint32_t Adafruit_INA228::_unpackPower(void) {
+  return ((uint32_t)_buffer[11] << 16) | ((uint32_t)_buffer[12] << 8) |
+         _buffer[13];
+}
+
+/**************************************************************************/
+/*!
+    @brief Decodes the DIETEMP slice of the receive buffer.
+    @return The 16-bit two's complement value
+*/
+/**************************************************************************/
+int16_t Adafruit_INA228::_unpackDieTemp(void) {
+  return (int16_t)(((uint16_t)_buffer[14] << 8) | _buffer[15]);
+}
+
+/**************************************************************************/
+/*!
+    @brief Decodes the CHARGE slice of the receive buffer.
+    @return The 40-bit two's complement value, sign-extended
+*/
+/**************************************************************************/
+int64_t Adafruit_INA228::_unpackCharge(void) {
+  uint64_t q = 0;
+  for (int i = 16; i < 21; i++) {
+    q = (q << 8) | _buffer[i];
+  }
+  if (q & 0x8000000000ULL)
+    q |= 0xFFFFFF0000000000ULL;
+  return (int64_t)q;
 }
 
 /**************************************************************************/
@@ -259,8 +773,7 @@ float Adafruit_INA228::readEnergy(void) {
 */
 /**************************************************************************/
 INA228_MeasurementMode Adafruit_INA228::getMode(void) {
-  Adafruit_I2CRegisterBits mode = Adafruit_I2CRegisterBits(ADC_Config, 4, 12);
-  return (INA228_MeasurementMode)mode.read();
+  return (INA228_MeasurementMode)_readShadowBits(ADC_Config, 4, 12);
 }
 /**************************************************************************/
 /*!
@@ -270,8 +783,18 @@ INA228_MeasurementMode Adafruit_INA228::getMode(void) {
 */
 /**************************************************************************/
 void Adafruit_INA228::setMode(INA228_MeasurementMode new_mode) {
-  Adafruit_I2CRegisterBits mode = Adafruit_I2CRegisterBits(ADC_Config, 4, 12);
-  mode.write(new_mode);
+  _writeShadowBits(ADC_Config, 4, 12, new_mode);
+}
+/**************************************************************************/
+/*!
+    @brief Starts a one-shot measurement when in one of the triggered modes,
+    by writing the last written ADC_CONFIG value back to the chip. Always
+    writes, unlike setMode() which skips the write when nothing changes.
+    @return True on success
+*/
+/**************************************************************************/
+bool Adafruit_INA228::triggerConversion(void) {
+  return ADC_Config->write(ADC_Config->readCached());
 }
 /**************************************************************************/
 /*!
@@ -280,9 +803,7 @@ void Adafruit_INA228::setMode(INA228_MeasurementMode new_mode) {
 */
 /**************************************************************************/
 INA228_AveragingCount Adafruit_INA228::getAveragingCount(void) {
-  Adafruit_I2CRegisterBits averaging_count =
-      Adafruit_I2CRegisterBits(ADC_Config, 3, 0);
-  return (INA228_AveragingCount)averaging_count.read();
+  return (INA228_AveragingCount)_readShadowBits(ADC_Config, 3, 0);
 }
 /**************************************************************************/
 /*!
@@ -292,9 +813,34 @@ INA228_AveragingCount Adafruit_INA228::getAveragingCount(void) {
 */
 /**************************************************************************/
 void Adafruit_INA228::setAveragingCount(INA228_AveragingCount count) {
-  Adafruit_I2CRegisterBits averaging_count =
-      Adafruit_I2CRegisterBits(ADC_Config, 3, 0);
-  averaging_count.write(count);
+  _writeShadowBits(ADC_Config, 3, 0, count);
+}
+/**************************************************************************/
+/*!
+    @brief Sets the measurement mode, the three conversion times and the
+    averaging count with a single write of ADC_CONFIG, skipped when nothing
+    changes. Calling the separate setters instead costs one write each.
+    @param mode
+           The new measurement mode
+    @param bus_time
+           The new bus voltage conversion time
+    @param shunt_time
+           The new current conversion time
+    @param temp_time
+           The new temperature conversion time
+    @param count
+           The number of samples to be averaged
+*/
+/**************************************************************************/
+void Adafruit_INA228::setADCConfig(INA228_MeasurementMode mode,
+                                   INA228_ConversionTime bus_time,
+                                   INA228_ConversionTime shunt_time,
+                                   INA228_ConversionTime temp_time,
+                                   INA228_AveragingCount count) {
+  _writeShadowBits(ADC_Config, 16, 0,
+                   ((uint32_t)mode << 12) | ((uint32_t)bus_time << 9) |
+                       ((uint32_t)shunt_time << 6) |
+                       ((uint32_t)temp_time << 3) | count);
 }
 /**************************************************************************/
 /*!
@@ -303,9 +849,7 @@ void Adafruit_INA228::setAveragingCount(INA228_AveragingCount count) {
 */
 /**************************************************************************/
 INA228_ConversionTime Adafruit_INA228::getCurrentConversionTime(void) {
-  Adafruit_I2CRegisterBits current_conversion_time =
-      Adafruit_I2CRegisterBits(ADC_Config, 3, 6);
-  return (INA228_ConversionTime)current_conversion_time.read();
+  return (INA228_ConversionTime)_readShadowBits(ADC_Config, 3, 6);
 }
 /**************************************************************************/
 /*!
@@ -315,9 +859,7 @@ INA228_ConversionTime Adafruit_INA228::getCurrentConversionTime(void) {
 */
 /**************************************************************************/
 void Adafruit_INA228::setCurrentConversionTime(INA228_ConversionTime time) {
-  Adafruit_I2CRegisterBits current_conversion_time =
-      Adafruit_I2CRegisterBits(ADC_Config, 3, 6);
-  current_conversion_time.write(time);
+  _writeShadowBits(ADC_Config, 3, 6, time);
 }
 /**************************************************************************/
 /*!
@@ -326,9 +868,7 @@ void Adafruit_INA228::setCurrentConversionTime(INA228_ConversionTime time) {
 */
 /**************************************************************************/
 INA228_ConversionTime Adafruit_INA228::getVoltageConversionTime(void) {
-  Adafruit_I2CRegisterBits voltage_conversion_time =
-      Adafruit_I2CRegisterBits(ADC_Config, 3, 9);
-  return (INA228_ConversionTime)voltage_conversion_time.read();
+  return (INA228_ConversionTime)_readShadowBits(ADC_Config, 3, 9);
 }
 /**************************************************************************/
 /*!
@@ -338,9 +878,7 @@ INA228_ConversionTime Adafruit_INA228::getVoltageConversionTime(void) {
 */
 /**************************************************************************/
 void Adafruit_INA228::setVoltageConversionTime(INA228_ConversionTime time) {
-  Adafruit_I2CRegisterBits voltage_conversion_time =
-      Adafruit_I2CRegisterBits(ADC_Config, 3, 9);
-  voltage_conversion_time.write(time);
+  _writeShadowBits(ADC_Config, 3, 9, time);
 }
 /**************************************************************************/
 /*!
@@ -349,9 +887,7 @@ void Adafruit_INA228::setVoltageConversionTime(INA228_ConversionTime time) {
 */
 /**************************************************************************/
 INA228_ConversionTime Adafruit_INA228::getTemperatureConversionTime(void) {
-  Adafruit_I2CRegisterBits temperature_conversion_time =
-      Adafruit_I2CRegisterBits(ADC_Config, 3, 3);
-  return (INA228_ConversionTime)temperature_conversion_time.read();
+  return (INA228_ConversionTime)_readShadowBits(ADC_Config, 3, 3);
 }
 /**************************************************************************/
 /*!
@@ -361,9 +897,7 @@ INA228_ConversionTime Adafruit_INA228::getTemperatureConversionTime(void) {
 */
 /**************************************************************************/
 void Adafruit_INA228::setTemperatureConversionTime(INA228_ConversionTime time) {
-  Adafruit_I2CRegisterBits temperature_conversion_time =
-      Adafruit_I2CRegisterBits(ADC_Config, 3, 3);
-  temperature_conversion_time.write(time);
+  _writeShadowBits(ADC_Config, 3, 3, time);
 }
 
 /**************************************************************************/
@@ -425,6 +959,29 @@ void Adafruit_INA228::setAlertLatch(INA228_AlertLatch state) {
   alert_latch.write(state);
 }
 /**************************************************************************/
+/*!
+    @brief Reads whether the ALERT pin asserts on conversion ready
+    @return True if the conversion ready alert is enabled
+*/
+/**************************************************************************/
+bool Adafruit_INA228::getConversionReadyAlert(void) {
+  Adafruit_I2CRegisterBits alert_conv =
+      Adafruit_I2CRegisterBits(Diag_Alert, 1, 14);
+  return alert_conv.read();
+}
+/**************************************************************************/
+/*!
+    @brief Sets whether the ALERT pin asserts on conversion ready (CNVR bit)
+    @param enable
+           True to assert the ALERT pin each time a conversion has completed
+*/
+/**************************************************************************/
+void Adafruit_INA228::setConversionReadyAlert(bool enable) {
+  Adafruit_I2CRegisterBits alert_conv =
+      Adafruit_I2CRegisterBits(Diag_Alert, 1, 14);
+  alert_conv.write(enable);
+}
+/**************************************************************************/
 /*!
     @brief Reads the 12 possible alert reason bits from DIAG_ALRT
     @return 10 bits that indiccate MEMSTAT (bit 0), CONVRF, POL, BUSUL, BUSOL,
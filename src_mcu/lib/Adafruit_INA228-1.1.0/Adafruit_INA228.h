@@ -18,6 +18,7 @@
 #define _ADAFRUIT_INA228_H
 
 #include "Arduino.h"
+#include <Adafruit_I2CAsync.h>
 #include <Adafruit_I2CDevice.h>
 #include <Adafruit_I2CRegister.h>
 #include <Wire.h>
@@ -163,6 +164,52 @@ typedef enum _alert_latch {
                                            cleared **/
 } INA228_AlertLatch;
 
+/// [uV] Bus voltage LSB is 195.3125 uV, i.e. 3125 / 2^4
+constexpr uint32_t INA228_VBUS_LSB_NUM = 3125;
+constexpr uint8_t INA228_VBUS_LSB_SHIFT = 4;
+
+/// Energy LSB is 16 * 3.2 = 256 / 5 times the power LSB, which makes it
+/// max current [uA] / INA228_ENERGY_LSB_DIV in [uJ] for a current LSB of
+/// max current / 2^19
+constexpr uint32_t INA228_ENERGY_LSB_DIV = (5UL << 19) / 256;
+
+/**
+ * @brief Result registers to acquire.
+ *
+ * Allowed bitmasks for readMeasurement, measurementJobs and decodeMeasurement.
+ */
+typedef enum _channel {
+  INA228_CH_CURRENT = 0x01,     ///< CURRENT register
+  INA228_CH_BUS_VOLTAGE = 0x02, ///< VBUS register
+  INA228_CH_ENERGY = 0x04,      ///< ENERGY register
+  INA228_CH_POWER = 0x08,       ///< POWER register
+  INA228_CH_DIE_TEMP = 0x10,    ///< DIETEMP register
+  INA228_CH_CHARGE = 0x20,      ///< CHARGE register
+  INA228_CH_DEFAULT = INA228_CH_CURRENT | INA228_CH_BUS_VOLTAGE |
+                      INA228_CH_ENERGY, ///< Current, bus voltage and energy
+  INA228_CH_ALL = 0x3F                  ///< All of the result registers above
+} INA228_Channel;
+
+/*!
+ *    @brief  Raw register counts and scaled values of a single measurement, as
+ *            filled in by readMeasurement(). Only the selected channels are
+ *            valid.
+ */
+typedef struct _measurement {
+  int32_t current_raw;      ///< CURRENT register, 20-bit sign-extended
+  uint32_t bus_voltage_raw; ///< VBUS register, 20-bit
+  uint64_t energy_raw;      ///< ENERGY register, 40-bit
+  uint32_t power_raw;       ///< POWER register, 24-bit
+  int16_t die_temp_raw;     ///< DIETEMP register, 16-bit
+  int64_t charge_raw;       ///< CHARGE register, 40-bit sign-extended
+  float current;            ///< Current in mA
+  float bus_voltage;        ///< Bus voltage in mV
+  float energy;             ///< Energy in J
+  float power;              ///< Power in mW
+  float die_temp;           ///< Die temperature in deg C
+  float charge;             ///< Charge in C
+} INA228_Measurement;
+
 /*!
  *    @brief  Class that stores state and functions for interacting with
  *            INA228 Current and Power Sensor
@@ -173,10 +220,13 @@ public:
   bool begin(uint8_t i2c_addr = INA228_I2CADDR_DEFAULT,
              TwoWire *theWire = &Wire, bool skipReset = false);
   void reset(void);
+  bool resync(void);
   void resetAccumulators(void);
+  bool setI2CSpeed(uint32_t clock);
 
   void setShunt(float shunt_res = 0.1, float max_current = 3.2);
   void setADCRange(uint8_t);
+  void setCalibration(float shunt_res, float max_current, uint8_t adc_range);
   uint8_t getADCRange(void);
   float readDieTemp(void);
 
@@ -185,9 +235,39 @@ public:
   float readShuntVoltage(void);
   float readPower(void);
   float readEnergy(void);
+  float readCharge(void);
+
+  int32_t readCurrentRaw(void);
+  uint32_t readBusVoltageRaw(void);
+  uint64_t readEnergyRaw(void);
+  int64_t readChargeRaw(void);
+
+  int32_t readCurrent_uA(void);
+  int32_t readBusVoltage_uV(void);
+  uint64_t readEnergy_uJ(void);
+
+  int32_t currentRawTo_uA(int32_t current_raw);
+  int32_t busVoltageRawTo_uV(uint32_t bus_voltage_raw);
+  uint64_t energyRawTo_uJ(uint64_t energy_raw);
+  int64_t chargeRawTo_uC(int64_t charge_raw);
+
+  bool readMeasurement(INA228_Measurement &meas,
+                       uint8_t channels = INA228_CH_DEFAULT);
+  uint8_t measurementJobs(Adafruit_I2CAsyncJob *jobs,
+                          uint8_t channels = INA228_CH_DEFAULT);
+  void decodeMeasurement(INA228_Measurement &meas,
+                         uint8_t channels = INA228_CH_DEFAULT);
+
+  bool readSnapshot(INA228_Measurement &meas,
+                    uint8_t channels = INA228_CH_DEFAULT,
+                    bool *coherent = nullptr);
+  uint8_t snapshotJobs(Adafruit_I2CAsyncJob *jobs,
+                       uint8_t channels = INA228_CH_DEFAULT);
+  bool snapshotCoherent(void);
 
   void setMode(INA228_MeasurementMode mode);
   INA228_MeasurementMode getMode(void);
+  bool triggerConversion(void);
 
   bool conversionReady(void);
   uint16_t alertFunctionFlags(void);
@@ -198,6 +278,8 @@ public:
   void setAlertLatch(INA228_AlertLatch state);
   INA228_AlertPolarity getAlertPolarity(void);
   void setAlertPolarity(INA228_AlertPolarity polarity);
+  bool getConversionReadyAlert(void);
+  void setConversionReadyAlert(bool enable);
   // INA228_AlertType getAlertType(void);
   // void setAlertType(INA228_AlertType alert);
 
@@ -209,16 +291,57 @@ public:
   void setTemperatureConversionTime(INA228_ConversionTime time);
   INA228_AveragingCount getAveragingCount(void);
   void setAveragingCount(INA228_AveragingCount count);
+  void setADCConfig(INA228_MeasurementMode mode,
+                    INA228_ConversionTime bus_time,
+                    INA228_ConversionTime shunt_time,
+                    INA228_ConversionTime temp_time,
+                    INA228_AveragingCount count);
 
   Adafruit_I2CRegister *Config, ///< BusIO Register for Config
       *ADC_Config,              ///< BusIO Register for Config
       *Diag_Alert,              ///< BusIO Register for MaskEnable
-      *AlertLimit;              ///< BusIO Register for AlertLimit
+      *AlertLimit,              ///< BusIO Register for AlertLimit
+      *Current,                 ///< BusIO Register for Current
+      *Bus_Voltage,             ///< BusIO Register for Bus Voltage
+      *Energy,                  ///< BusIO Register for Energy
+      *Shunt_Cal,               ///< BusIO Register for Shunt Calibration
+      *Power,                   ///< BusIO Register for Power
+      *Die_Temp,                ///< BusIO Register for Die Temperature
+      *Charge;                  ///< BusIO Register for Charge
 
 private:
+  Adafruit_I2CRegister *_placeRegister(uint8_t slot, uint16_t reg_addr,
+                                       uint8_t width);
   void _updateShuntCalRegister(void);
+  void _strobeConfigBit(uint8_t bit);
+  uint32_t _readShadowBits(Adafruit_I2CRegister *reg, uint8_t bits,
+                           uint8_t shift);
+  bool _writeShadowBits(Adafruit_I2CRegister *reg, uint8_t bits, uint8_t shift,
+                        uint32_t value);
+  int32_t _unpackCurrent(void);
+  uint32_t _unpackBusVoltage(void);
+  uint64_t _unpackEnergy(void);
+  uint32_t _unpackPower(void);
+  int16_t _unpackDieTemp(void);
+  int64_t _unpackCharge(void);
+
+  /// Receive buffer: CURRENT[3], VBUS[3], ENERGY[5], POWER[3], DIETEMP[2],
+  /// CHARGE[5], DIAG_ALRT[2]
+  uint8_t _buffer[23];
+
+  /// Number of preallocated BusIO registers
+  static const uint8_t _N_REGISTERS = 10;
+  /// Storage of the I2C device, constructed in place by begin()
+  alignas(Adafruit_I2CDevice) uint8_t
+      _i2c_dev_storage[sizeof(Adafruit_I2CDevice)];
+  /// Storage of the BusIO registers, constructed in place by begin()
+  alignas(Adafruit_I2CRegister) uint8_t
+      _register_storage[_N_REGISTERS][sizeof(Adafruit_I2CRegister)];
+
   float _shunt_res;
-  float _current_lsb;
+  float _current_lsb;      ///< [A]
+  float _energy_lsb;       ///< [J]
+  int32_t _max_current_uA; ///< [uA] Current LSB times 2^19
   Adafruit_I2CDevice *i2c_dev;
 };
 
@@ -9,54 +9,126 @@ _port(mySerial)   // Initialise reference before body
 {
   _strIn[0] = '\0';
   _fTerminated = false;
+  _fRetrieved = false;
   _iPos = 0;
+  _iScan = 0;
+  _iLen = 0;
+  _commands = nullptr;
+  _nCommands = 0;
 }
 
 bool DvG_SerialCommand::available() {
   char c;
 
-  // Poll serial buffer
-  if (_port.available()) {
-    _fTerminated = false;
-    while (_port.available()) {
-      c = _port.peek();
-      if (c == 13) {
-        // Ignore ASCII 13 (carriage return)
-        _port.read();             // Remove char from serial buffer
-      } else if (c == 10) {
-        // Found the proper termination character ASCII 10 (line feed)
-        _port.read();             // Remove char from serial buffer
-        _strIn[_iPos] = '\0';     // Terminate string
-        _fTerminated = true;
-        break;
-      } else if (_iPos < STR_LEN - 1) {
-        // Maximum length of incoming serial command is not yet reached. Append
-        // characters to string.
-        _port.read();             // Remove char from serial buffer
-        _strIn[_iPos] = c;
-        _iPos++;
-      } else {
-        // Maximum length of incoming serial command is reached. Forcefully
-        // terminate string now. Leave the char in the serial buffer.
-        _strIn[_iPos] = '\0';     // Terminate string
-        _fTerminated = true;
-        break;
-      }
+  if (_fTerminated) {
+    // Previous command has not been retrieved yet
+    return true;
+  }
+
+  if (_fRetrieved) {
+    // Move the chars received after the retrieved command to the front
+    _fRetrieved = false;
+    _iLen -= _iScan;
+    memmove(_strIn, _strIn + _iScan, _iLen);
+    _iScan = 0;
+    _iPos = 0;
+  }
+
+  // Take in all chars that are waiting and fit, in one go. Never blocks,
+  // because no more chars get requested than are available.
+  int nAvail = _port.available();
+  int nFree = STR_LEN - 1 - _iLen;
+  if ((nAvail > 0) && (nFree > 0)) {
+    _iLen += _port.readBytes(_strIn + _iLen, (nAvail < nFree) ? nAvail : nFree);
+  }
+
+  // Scan the new chars, compacting the command in place
+  while (_iScan < _iLen) {
+    c = _strIn[_iScan++];
+    if (c == 13) {
+      // Ignore ASCII 13 (carriage return)
+    } else if (c == 10) {
+      // Found the proper termination character ASCII 10 (line feed)
+      _strIn[_iPos] = '\0';       // Terminate string
+      _fTerminated = true;
+      return true;
+    } else {
+      _strIn[_iPos] = c;
+      _iPos++;
     }
   }
+
+  // All received chars are part of the command being built up
+  _iLen = _iPos;
+  _iScan = _iPos;
+
+  if (_iPos >= STR_LEN - 1) {
+    // Maximum length of incoming serial command is reached. Forcefully
+    // terminate string now. Leave any further chars in the serial buffer.
+    _strIn[_iPos] = '\0';         // Terminate string
+    _fTerminated = true;
+  }
   return _fTerminated;
 }
 
 char* DvG_SerialCommand::getCmd() {
   if (_fTerminated) {
     _fTerminated = false;     // Reset incoming serial command char array
-    _iPos = 0;                // Reset incoming serial command char array
+    _fRetrieved = true;       // Reset it once the command got processed
     return (char*) _strIn;
   } else {
     return (char*) _empty;
   }
 }
 
+void DvG_SerialCommand::setCommands(const DvG_Command* table,
+                                    uint8_t n_commands) {
+  _commands = table;
+  _nCommands = n_commands;
+}
+
+bool DvG_SerialCommand::dispatch() {
+  char*   argv[MAX_ARGS];
+  uint8_t argc = 0;
+  char*   p;
+
+  if (!available()) {
+    return false;
+  }
+
+  // Split on spaces in place
+  p = getCmd();
+  while (*p != '\0' && argc < MAX_ARGS) {
+    if (*p == ' ') {
+      p++;
+      continue;
+    }
+    argv[argc++] = p;
+    while (*p != '\0' && *p != ' ') {
+      p++;
+    }
+    if (*p == ' ') {
+      *p++ = '\0';
+    }
+  }
+
+  if (argc == 0) {
+    return false;
+  }
+
+  for (uint8_t i = 0; i < _nCommands; i++) {
+    if (strcmp(argv[0], _commands[i].name) == 0) {
+      _commands[i].handler(argc, argv);
+      return true;
+    }
+  }
+
+  _port.print("ERROR: Unknown command '");
+  _port.print(argv[0]);
+  _port.println("'");
+  return false;
+}
+
 /*------------------------------------------------------------------------------
     Parse float value at end of string 'strIn' starting at position 'iPos'
 ------------------------------------------------------------------------------*/
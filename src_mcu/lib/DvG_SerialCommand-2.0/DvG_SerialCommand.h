@@ -10,7 +10,13 @@ It doesn't matter if the command is ASCII or binary encoded.
 
 'available()' should be called periodically to poll for incoming characters. It
 will return true when a new command is ready to be processed. Subsequently, the
-command string can be retrieved by calling 'getCmd()'.
+command string can be retrieved by calling 'getCmd()'. All characters already
+waiting in the serial buffer get taken in with a single 'readBytes()' call.
+
+Alternatively, register a table of commands with 'setCommands()' and call
+'dispatch()' periodically instead. It splits the command on spaces, in place,
+into the command name and its arguments and calls the handler registered for
+that name. Unknown commands get an error reply over the serial port.
 
 Dennis van Gils, 11-03-2020
 */
@@ -22,7 +28,26 @@ Dennis van Gils, 11-03-2020
 
 // Buffer size for storing incoming characters. Includes the '\0' termination
 // character. Change buffer size to your needs up to a maximum of 255.
-#define STR_LEN 32
+#ifndef STR_LEN
+#define STR_LEN 64
+#endif
+
+// Maximum number of tokens handed to a command handler by 'dispatch()',
+// including the command name. Any further tokens get ignored.
+#ifndef MAX_ARGS
+#define MAX_ARGS 8
+#endif
+
+// Handler of a command. 'argv[0]' is the command name, followed by 'argc - 1'
+// arguments. The tokens point into the receive buffer and stay valid until the
+// next call to 'available()' or 'dispatch()'.
+typedef void (*DvG_CommandHandler)(uint8_t argc, char** argv);
+
+// Entry of a command table as registered with 'setCommands()'
+struct DvG_Command {
+  const char*        name;     // Command name, must match the first token
+  DvG_CommandHandler handler;  // Function to call
+};
 
 class DvG_SerialCommand {
  public:
@@ -36,13 +61,29 @@ class DvG_SerialCommand {
   // an empty C-string.
   char* getCmd();
 
+  // Register the table of 'n_commands' commands to be looked up by
+  // 'dispatch()'. The table must stay valid, typically a global const array.
+  void setCommands(const DvG_Command* table, uint8_t n_commands);
+
+  // Poll the serial port and, once a command is ready, call its handler from
+  // the registered table. Return true if a command got handled. Unknown
+  // commands get an error reply, empty ones are ignored.
+  bool dispatch();
+
  private:
   Stream& _port;              // Serial port reference
-  char    _strIn[STR_LEN];    // Incoming serial command string
+  char    _strIn[STR_LEN];    // Incoming serial command string, followed by
+                              // any characters received after it
   bool    _fTerminated;       // Incoming serial command is/got terminated?
+  bool    _fRetrieved;        // Terminated command got retrieved?
   uint8_t _iPos;              // Index within _strIn to insert new char
+  uint8_t _iScan;             // Index within _strIn of next char to scan
+  uint8_t _iLen;              // Number of chars received into _strIn
   const char* _empty = "\0";  // Reply when trying to retrieve command when not
                               // yet terminated
+
+  const DvG_Command* _commands;   // Registered command table
+  uint8_t            _nCommands;  // Number of entries in the table
 };
 
 /*------------------------------------------------------------------------------
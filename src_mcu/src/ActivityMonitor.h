@@ -0,0 +1,78 @@
+/*
+Tells whether the signal of a sensor shows activity, to let the adaptive
+scheduler of `main.cpp` decide between fast and slow conversions. The samples
+of a window get gathered in a `ChannelStats` as their deviation from the mean
+of the previous window, so that its RMS covers both the fluctuations within
+the window and a step in between windows. Taking the deviation also keeps the
+float sums well conditioned on a large steady current.
+
+A window whose RMS deviation exceeds the threshold makes the sensor active
+right away, while it takes `hold` windows in a row below the threshold to
+turn it idle again. A window needs at least `MIN_COUNT` samples to count, a
+shorter one carries on into the next.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_ActivityMonitor
+#define H_ActivityMonitor
+
+#include <Arduino.h>
+#include <math.h>
+
+#include "ChannelStats.h"
+
+struct ActivityMonitor {
+  static const uint32_t MIN_COUNT = 2;
+
+  ChannelStats dev; // Deviation of the samples from `ref` over the window
+  float ref;        // Mean of the previous window, NaN before any sample
+  float activity;   // RMS deviation of the last completed window
+  uint8_t n_quiet;  // Number of completed windows in a row below threshold
+  bool active;
+
+  // Start over as active, so that a sensor only gets slowed down once it
+  // proved to be idle
+  void reset() {
+    dev.reset();
+    ref = NAN;
+    activity = NAN;
+    n_quiet = 0;
+    active = true;
+  }
+
+  void add(float x) {
+    if (isnan(x)) {
+      return;
+    }
+    if (isnan(ref)) {
+      ref = x;
+    }
+    dev.add(x - ref);
+  }
+
+  // Complete the window and decide on the activity. Returns true when
+  // `active` changed.
+  bool close_window(float threshold, uint8_t hold) {
+    if (dev.count < MIN_COUNT) {
+      return false;
+    }
+    activity = dev.rms();
+    ref += dev.mean();
+    dev.reset();
+
+    bool was_active = active;
+    if (activity > threshold) {
+      n_quiet = 0;
+      active = true;
+    } else {
+      if (n_quiet < hold) {
+        n_quiet++;
+      }
+      active = (n_quiet < hold);
+    }
+    return active != was_active;
+  }
+};
+
+#endif
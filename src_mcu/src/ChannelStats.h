@@ -0,0 +1,47 @@
+/*
+Running statistics of a single channel over a window of samples: count, mean,
+minimum, maximum and root-mean-square. Uses single-precision floats only, which
+the Cortex-M4F handles in hardware. Intended for windows of up to some 1e5
+samples, after which the float sums start losing resolution.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_ChannelStats
+#define H_ChannelStats
+
+#include <Arduino.h>
+#include <math.h>
+
+struct ChannelStats {
+  uint32_t count;
+  float sum;
+  float sum_sq;
+  float min;
+  float max;
+
+  void reset() {
+    count = 0;
+    sum = 0;
+    sum_sq = 0;
+    min = INFINITY;
+    max = -INFINITY;
+  }
+
+  void add(float x) {
+    count++;
+    sum += x;
+    sum_sq += x * x;
+    if (x < min) {
+      min = x;
+    }
+    if (x > max) {
+      max = x;
+    }
+  }
+
+  float mean() const { return count ? sum / count : NAN; }
+  float rms() const { return count ? sqrtf(sum_sq / count) : NAN; }
+};
+
+#endif
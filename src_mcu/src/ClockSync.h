@@ -0,0 +1,123 @@
+/*
+Maps the local timestamps of the Arduino onto the clock of the host PC, so
+that several boards attached to the same host share a common timebase. The
+host measures pairs of a local timestamp and the host time at that instant,
+see `sync` in `main.cpp`, and each pair gets added with `add()`. A straight
+line fitted through the last `N_POINTS` pairs gives the offset at the latest
+pair and the drift of the crystal of the Arduino relative to the host clock.
+`to_host()` then extrapolates along that line, which keeps the boards aligned
+between pairs.
+
+The drift only gets fitted once the pairs span at least `MIN_DRIFT_SPAN_US`,
+the offset is the mean of the pairs until then. A pair that lies further than
+`MAX_STEP_US` off the line means that a clock got set, e.g. by NTP on the
+host, and starts the fit over. Without any pair the local time passes
+unchanged.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_ClockSync
+#define H_ClockSync
+
+#include <Arduino.h>
+
+struct ClockSync {
+  static const uint8_t N_POINTS = 8;
+  static const uint64_t MIN_DRIFT_SPAN_US = 10000000;
+  static const int64_t MAX_STEP_US = 100000;
+  static const int32_t MAX_DRIFT_PPB = 1000000; // Far beyond any crystal
+
+  uint64_t local_us[N_POINTS]; // [us] Local timestamps of the pairs
+  int64_t offset_us[N_POINTS]; // [us] Host minus local time of the pairs
+  uint8_t n_points;            // Number of valid pairs
+  uint8_t head;                // Index of the latest pair
+
+  // Result of the fit
+  uint64_t ref_us;       // [us] Local timestamp the offset applies to
+  int64_t ref_offset_us; // [us] Host minus local time at `ref_us`
+  int32_t drift_ppb;     // [ppb] Host clock rate relative to the local one
+  uint32_t residual_us;  // [us] Largest deviation of a pair from the line
+
+  // Drop all pairs and return to the local clock
+  void reset() {
+    n_points = 0;
+    head = 0;
+    ref_us = 0;
+    ref_offset_us = 0;
+    drift_ppb = 0;
+    residual_us = 0;
+  }
+
+  bool synced() const { return n_points > 0; }
+
+  // [us] Host time corresponding to the local timestamp `local`
+  uint64_t to_host(uint64_t local) const {
+    int64_t dt = (int64_t)(local - ref_us);
+    return local + ref_offset_us + dt * drift_ppb / 1000000000;
+  }
+
+  // Add the pair of local timestamp `local` and host time `host`, both [us]
+  void add(uint64_t local, uint64_t host) {
+    int64_t offset = (int64_t)(host - local);
+    if (synced()) {
+      int64_t step = offset - (int64_t)(to_host(local) - local);
+      if ((step > MAX_STEP_US) || (step < -MAX_STEP_US)) {
+        reset();
+      }
+    }
+
+    head = synced() ? (head + 1) % N_POINTS : 0;
+    local_us[head] = local;
+    offset_us[head] = offset;
+    if (n_points < N_POINTS) {
+      n_points++;
+    }
+    fit();
+  }
+
+private:
+  void fit() {
+    /* Least squares line through the pairs, relative to the latest one to
+    keep the doubles well within their precision. Only runs when a pair gets
+    added, so the soft-float doubles do not matter.
+    */
+    double sx = 0, sy = 0, sxx = 0, sxy = 0; // x [s], y [us]
+    for (uint8_t i = 0; i < n_points; i++) {
+      double x = (double)(int64_t)(local_us[i] - local_us[head]) * 1e-6;
+      double y = (double)(offset_us[i] - offset_us[head]);
+      sx += x;
+      sy += y;
+      sxx += x * x;
+      sxy += x * y;
+    }
+    double slope = 0; // [us/s], i.e. [ppm]
+    if (local_us[head] - oldest() >= MIN_DRIFT_SPAN_US) {
+      slope = (n_points * sxy - sx * sy) / (n_points * sxx - sx * sx);
+      if (fabs(slope) > MAX_DRIFT_PPB * 1e-3) {
+        slope = (slope > 0 ? MAX_DRIFT_PPB : -MAX_DRIFT_PPB) * 1e-3;
+      }
+    }
+    double intercept = (sy - slope * sx) / n_points;
+
+    ref_us = local_us[head];
+    ref_offset_us = offset_us[head] + (int64_t)llround(intercept);
+    drift_ppb = (int32_t)lround(slope * 1e3);
+
+    residual_us = 0;
+    for (uint8_t i = 0; i < n_points; i++) {
+      double x = (double)(int64_t)(local_us[i] - local_us[head]) * 1e-6;
+      double y = (double)(offset_us[i] - offset_us[head]);
+      uint32_t dev = (uint32_t)fabs(y - intercept - slope * x);
+      if (dev > residual_us) {
+        residual_us = dev;
+      }
+    }
+  }
+
+  uint64_t oldest() const {
+    return local_us[(n_points < N_POINTS) ? 0 : (head + 1) % N_POINTS];
+  }
+};
+
+#endif
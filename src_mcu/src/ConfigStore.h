@@ -0,0 +1,141 @@
+/*
+Keeps a single configuration record of type `T` in the last 8 kB block of the
+SAMD51 flash, where it survives power cycles and firmware uploads that do not
+erase the whole chip. The record is stored together with a magic word, the
+`VERSION` of its layout, its size and a CRC-32, and `load()` only accepts it
+when all of these match. Bump `VERSION` whenever the layout of `T` changes, so
+that an old record gets ignored instead of misread.
+
+Plain flash instead of the SmartEEPROM, because the latter needs fuses set
+in the user page that the stock bootloader leaves off. Saving erases and
+rewrites the whole block, which takes some tens of ms and wears the flash, so
+only save on request. The block sits in the second flash bank, so the CPU
+keeps running from the first one while writing.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_ConfigStore
+#define H_ConfigStore
+
+#include <Arduino.h>
+
+template <typename T, uint16_t VERSION> class ConfigStore {
+  static const uint32_t MAGIC = 0x57464346; // "WFCF"
+  static const uint32_t PAGE_SIZE = 512;    // [bytes] Unit of writing
+  static const uint32_t BLOCK_SIZE = 8192;  // [bytes] Unit of erasing
+  static const uint32_t ADDRESS = FLASH_ADDR + FLASH_SIZE - BLOCK_SIZE;
+
+  struct Record {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;
+    uint32_t crc; // CRC-32 of `data`
+    T data;
+  };
+  static_assert(sizeof(Record) <= BLOCK_SIZE, "Record exceeds a flash block");
+
+public:
+  // Copy the stored record into `data` when valid, leaving it untouched
+  // otherwise. Returns whether it was valid.
+  bool load(T &data) const {
+    const Record *rec = (const Record *)ADDRESS;
+    if ((rec->magic != MAGIC) || (rec->version != VERSION) ||
+        (rec->size != sizeof(T)) ||
+        (rec->crc != crc32((const uint8_t *)&rec->data, sizeof(T)))) {
+      return false;
+    }
+    memcpy(&data, &rec->data, sizeof(T));
+    return true;
+  }
+
+  // Store `data` and read it back. Returns whether it verified.
+  bool save(const T &data) {
+    // Whole words only, padded with the erased state of the flash
+    const uint32_t N_WORDS = (sizeof(Record) + 3) / 4;
+    union {
+      Record rec;
+      uint32_t words[N_WORDS];
+    } image;
+    memset(&image, 0xFF, sizeof(image));
+    image.rec.magic = MAGIC;
+    image.rec.version = VERSION;
+    image.rec.size = sizeof(T);
+    image.rec.crc = crc32((const uint8_t *)&data, sizeof(T));
+    memcpy(&image.rec.data, &data, sizeof(T));
+
+    begin_write();
+    command(ADDRESS, NVMCTRL_CTRLB_CMD_EB);
+    volatile uint32_t *dest = (volatile uint32_t *)ADDRESS;
+    for (uint32_t i = 0; i < N_WORDS; i++) {
+      if (i % (PAGE_SIZE / 4) == 0) {
+        command(ADDRESS + i * 4, NVMCTRL_CTRLB_CMD_PBC);
+      }
+      dest[i] = image.words[i]; // Into the page buffer
+      if ((i % (PAGE_SIZE / 4) == PAGE_SIZE / 4 - 1) || (i == N_WORDS - 1)) {
+        command(ADDRESS + i * 4, NVMCTRL_CTRLB_CMD_WP);
+      }
+    }
+    end_write();
+
+    T check;
+    return load(check) && (memcmp(&check, &data, sizeof(T)) == 0);
+  }
+
+  // Invalidate the stored record, so that the defaults apply at next boot
+  void erase() {
+    begin_write();
+    command(ADDRESS, NVMCTRL_CTRLB_CMD_EB);
+    end_write();
+  }
+
+private:
+  uint8_t _wmode;
+  bool _cachedis0;
+  bool _cachedis1;
+
+  static uint32_t crc32(const uint8_t *data, size_t len) {
+    // CRC-32 (ISO-HDLC), identical to Python's `zlib.crc32(data)`
+    uint32_t crc = 0xFFFFFFFF;
+    while (len--) {
+      crc ^= *data++;
+      for (uint8_t bit = 0; bit < 8; bit++) {
+        crc = (crc & 1) ? (crc >> 1) ^ 0xEDB88320 : (crc >> 1);
+      }
+    }
+    return ~crc;
+  }
+
+  static void command(uint32_t address, uint32_t cmd) {
+    NVMCTRL->ADDR.reg = address;
+    NVMCTRL->CTRLB.reg = NVMCTRL_CTRLB_CMDEX_KEY | cmd;
+    while (!NVMCTRL->STATUS.bit.READY) {}
+  }
+
+  void begin_write() {
+    while (!NVMCTRL->STATUS.bit.READY) {}
+    // Manual page writes, and the NVM caches off while writing as per the
+    // SAMD51 errata
+    _wmode = NVMCTRL->CTRLA.bit.WMODE;
+    NVMCTRL->CTRLA.bit.WMODE = NVMCTRL_CTRLA_WMODE_MAN_Val;
+    _cachedis0 = NVMCTRL->CTRLA.bit.CACHEDIS0;
+    _cachedis1 = NVMCTRL->CTRLA.bit.CACHEDIS1;
+    NVMCTRL->CTRLA.bit.CACHEDIS0 = 1;
+    NVMCTRL->CTRLA.bit.CACHEDIS1 = 1;
+  }
+
+  void end_write() {
+    // Drop stale copies of the block from the Cortex-M cache
+    if (CMCC->SR.bit.CSTS) {
+      CMCC->CTRL.bit.CEN = 0;
+      while (CMCC->SR.bit.CSTS) {}
+      CMCC->MAINT0.bit.INVALL = 1;
+      CMCC->CTRL.bit.CEN = 1;
+    }
+    NVMCTRL->CTRLA.bit.CACHEDIS0 = _cachedis0;
+    NVMCTRL->CTRLA.bit.CACHEDIS1 = _cachedis1;
+    NVMCTRL->CTRLA.bit.WMODE = _wmode;
+  }
+};
+
+#endif
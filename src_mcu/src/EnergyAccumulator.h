@@ -0,0 +1,49 @@
+/*
+Extends the 40-bit ENERGY accumulator of an INA228 into a 64-bit total kept on
+the MCU, in the same register counts. Every new reading of the register gets
+folded in with `fold()`, adding the increase since the previous reading to the
+total. The total only starts over with `reset()`, so that long runs neither
+lose resolution nor depend on the chip accumulator staying untouched.
+
+A reading below the previous one means that the register either wrapped
+around or got reset, by a power cycle of the chip or by RSTACC. It is taken as
+a wrap when the increase across the wrap would stay below `MAX_WRAP_DELTA`,
+some 84 kJ for the Adafruit INA228 at 0.2 A full scale, and as a reset
+otherwise. After a reset the new reading is the increase itself. Readings
+must therefore be folded in often enough, say every second.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_EnergyAccumulator
+#define H_EnergyAccumulator
+
+#include <Arduino.h>
+
+struct EnergyAccumulator {
+  static const uint64_t REGISTER_RANGE = 1ULL << 40;
+  static const uint64_t MAX_WRAP_DELTA = 1ULL << 32;
+
+  uint64_t total;    // [ENERGY counts] Accumulated since `reset()`
+  uint64_t last_raw; // [ENERGY counts] Previous reading of the register
+
+  // Start over, right after the chip accumulator got reset as well
+  void reset() {
+    total = 0;
+    last_raw = 0;
+  }
+
+  // Fold in a new reading of the ENERGY register
+  void fold(uint64_t raw) {
+    if (raw >= last_raw) {
+      total += raw - last_raw;
+    } else if (REGISTER_RANGE - last_raw + raw < MAX_WRAP_DELTA) {
+      total += REGISTER_RANGE - last_raw + raw; // Wrapped around
+    } else {
+      total += raw; // Chip accumulator got reset
+    }
+    last_raw = raw;
+  }
+};
+
+#endif
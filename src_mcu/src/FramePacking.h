@@ -0,0 +1,46 @@
+/*
+Primitives for packing the binary frames sent to the host: little-endian
+integers of any length up to 8 bytes, IEEE-754 floats and the CRC-16 that
+closes every frame. Kept apart from `main.cpp` so that the native tests can
+check them and time the packing of a frame, see `test/native`.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_FramePacking
+#define H_FramePacking
+
+#include <Arduino.h>
+
+inline uint8_t *pack_le(uint8_t *dst, uint64_t value, uint8_t n_bytes) {
+  /* Write the lowest `n_bytes` of `value` little-endian into `dst` and return
+  the pointer to the byte following it.
+  */
+  for (uint8_t i = 0; i < n_bytes; i++) {
+    *dst++ = (uint8_t)value;
+    value >>= 8;
+  }
+  return dst;
+}
+
+inline uint8_t *pack_float(uint8_t *dst, float value) {
+  // Write `value` as little-endian IEEE-754 float32, same as the M4 itself
+  memcpy(dst, &value, 4);
+  return dst + 4;
+}
+
+inline uint16_t crc16_ccitt(const uint8_t *data, size_t len) {
+  /* CRC-16/CCITT-FALSE: poly 0x1021, init 0xFFFF, no reflection, no final XOR.
+  Identical to Python's `binascii.crc_hqx(data, 0xFFFF)`.
+  */
+  uint16_t crc = 0xFFFF;
+  while (len--) {
+    crc ^= (uint16_t)(*data++) << 8;
+    for (uint8_t i = 0; i < 8; i++) {
+      crc = (crc & 0x8000) ? (crc << 1) ^ 0x1021 : (crc << 1);
+    }
+  }
+  return crc;
+}
+
+#endif
@@ -0,0 +1,66 @@
+/*
+Latency histogram of a single stage of the main loop, fed with durations
+measured by the DWT cycle counter of the Cortex-M4. Every sample costs a
+subtraction, a count-leading-zeros and a few increments, so that the probes
+can stay in place in production firmware.
+
+The buckets are powers of 2 in microseconds: bucket 0 holds durations below
+1 us, bucket k holds [2^(k-1), 2^k) us and the last bucket holds everything
+longer than that.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_LatencyStats
+#define H_LatencyStats
+
+#include <Arduino.h>
+
+// Start the DWT cycle counter, once at boot
+inline void latency_stats_begin() {
+  CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+  DWT->CYCCNT = 0;
+  DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+// Current value of the cycle counter, rolls over every 35.8 s at 120 MHz
+inline uint32_t cycles_now() { return DWT->CYCCNT; }
+
+struct LatencyStats {
+  static const uint8_t N_BUCKETS = 16;
+  static const uint32_t CYCLES_PER_US = VARIANT_MCK / 1000000;
+
+  uint32_t count;
+  uint64_t sum_cycles;
+  uint32_t max_cycles;
+  uint32_t buckets[N_BUCKETS];
+
+  void reset() {
+    count = 0;
+    sum_cycles = 0;
+    max_cycles = 0;
+    memset(buckets, 0, sizeof(buckets));
+  }
+
+  // Add the duration since `start_cycles` as obtained from `cycles_now()`
+  void add_since(uint32_t start_cycles) { add(cycles_now() - start_cycles); }
+
+  void add(uint32_t cycles) {
+    count++;
+    sum_cycles += cycles;
+    if (cycles > max_cycles) {
+      max_cycles = cycles;
+    }
+
+    uint32_t bucket = 32 - __CLZ(cycles / CYCLES_PER_US);
+    buckets[(bucket < N_BUCKETS) ? bucket : N_BUCKETS - 1]++;
+  }
+
+  // [us]
+  uint32_t mean_us() const {
+    return count ? (uint32_t)(sum_cycles / count / CYCLES_PER_US) : 0;
+  }
+  uint32_t max_us() const { return max_cycles / CYCLES_PER_US; }
+};
+
+#endif
@@ -0,0 +1,66 @@
+/*
+Packs a sample into the binary frame sent to the host, see `Binary frame` in
+`main.cpp` for the layout. Kept apart from `main.cpp` so that the native
+tests check and time the very same packing, see `test/native`.
+
+The caller works out the energy increments, as they depend on what got sent
+before, and passes the latch offsets as they go out.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_SampleFrame
+#define H_SampleFrame
+
+#include <Arduino.h>
+
+#include "Adafruit_INA228.h"
+#include "FramePacking.h"
+
+const uint16_t BIN_SYNC = 0x5AA5;
+const size_t BIN_HEADER_LEN = 16;
+
+inline size_t pack_sample_frame(uint8_t *frame, uint32_t seq,
+                                uint64_t stamp_us, uint8_t channels,
+                                uint8_t slow, size_t n_sensors,
+                                const INA228_Measurement *meas,
+                                const uint32_t *energy_deltas,
+                                const int32_t *latch_offsets_us) {
+  /* Pack the selected `channels` of `n_sensors` sensors into `frame`, closed
+  by the CRC, and return the length of the frame [bytes]. `energy_deltas`
+  only gets read when energy is selected.
+  */
+  uint8_t *p = frame;
+  p = pack_le(p, BIN_SYNC, 2);
+  p = pack_le(p, seq, 4);
+  p = pack_le(p, stamp_us, 8);
+  p = pack_le(p, channels, 1);
+  p = pack_le(p, slow, 1);
+
+  for (size_t i = 0; i < n_sensors; i++) {
+    if (channels & INA228_CH_CURRENT) {
+      p = pack_le(p, (uint32_t)meas[i].current_raw, 3);
+    }
+    if (channels & INA228_CH_BUS_VOLTAGE) {
+      p = pack_le(p, meas[i].bus_voltage_raw, 3);
+    }
+    if (channels & INA228_CH_ENERGY) {
+      p = pack_le(p, energy_deltas[i], 3);
+    }
+    if (channels & INA228_CH_POWER) {
+      p = pack_le(p, meas[i].power_raw, 3);
+    }
+    if (channels & INA228_CH_DIE_TEMP) {
+      p = pack_le(p, (uint16_t)meas[i].die_temp_raw, 2);
+    }
+    if (channels & INA228_CH_CHARGE) {
+      p = pack_le(p, (uint64_t)meas[i].charge_raw, 5);
+    }
+    p = pack_le(p, (uint32_t)latch_offsets_us[i], 4);
+  }
+
+  p = pack_le(p, crc16_ccitt(frame + 2, p - frame - 2), 2);
+  return p - frame;
+}
+
+#endif
@@ -0,0 +1,79 @@
+/*
+Fixed-capacity, lock-free ring buffer for a single producer and a single
+consumer. The producer may run in an interrupt service routine while the
+consumer runs in the main loop, or vice versa, without disabling interrupts:
+each index is only ever written by one side.
+
+The producer claims a slot with `claim()`, fills it in place and publishes it
+with `commit()`. When the ring is full, `claim()` returns nullptr and the
+sample is counted as dropped. The consumer takes the oldest record with
+`front()` and releases it with `pop()`.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_SampleRing
+#define H_SampleRing
+
+#include <Arduino.h>
+
+template <typename T, uint32_t N> class SampleRing {
+  static_assert((N & (N - 1)) == 0, "Capacity must be a power of 2");
+
+public:
+  // Producer: return the slot to fill in next, or nullptr when full
+  T *claim() {
+    if (_head - _tail >= N) {
+      _dropped++;
+      return nullptr;
+    }
+    return &_records[_head & (N - 1)];
+  }
+
+  // Producer: publish the slot obtained by `claim()`
+  void commit() {
+    __DMB(); // Record contents must be visible before the index moves
+    _head = _head + 1;
+    uint32_t fill = _head - _tail;
+    if (fill > _max_fill) {
+      _max_fill = fill;
+    }
+  }
+
+  // Consumer: return the oldest record, or nullptr when empty
+  const T *front() const {
+    if (_head == _tail) {
+      return nullptr;
+    }
+    return &_records[_tail & (N - 1)];
+  }
+
+  // Consumer: release the record obtained by `front()`
+  void pop() {
+    __DMB();
+    _tail = _tail + 1;
+  }
+
+  // Discard all records. Only call when the producer is quiet.
+  void clear() { _tail = _head; }
+
+  uint32_t size() const { return _head - _tail; }
+  uint32_t capacity() const { return N; }
+
+  // Diagnostics
+  uint32_t dropped() const { return _dropped; }   // Samples lost to overflow
+  uint32_t max_fill() const { return _max_fill; } // High-water mark
+  void reset_counters() {
+    _dropped = 0;
+    _max_fill = 0;
+  }
+
+private:
+  T _records[N];
+  volatile uint32_t _head = 0; // Written by the producer only
+  volatile uint32_t _tail = 0; // Written by the consumer only
+  volatile uint32_t _dropped = 0;
+  volatile uint32_t _max_fill = 0;
+};
+
+#endif
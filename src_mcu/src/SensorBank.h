@@ -0,0 +1,304 @@
+/*
+Compile-time table of INA228 sensors, spread over up to two I2C buses. The
+template takes the channels that may get acquired, as a bitmask of
+`INA228_Channel`, and the I2C address of every sensor, optionally wrapped in
+`on_bus(bus, address)` to put it on the second bus. From these it lays out the
+sensor objects, the measurement results, the transfer jobs of a sweep grouped
+per bus and the maximum per-sensor length of a binary frame in static
+storage, so that the RAM footprint is fixed at compile time and the blocking
+sweep gets unrolled.
+
+  SensorBank<INA228_CH_CURRENT | INA228_CH_BUS_VOLTAGE,
+             0x40, 0x41, on_bus(1, 0x40), on_bus(1, 0x41)> bank;
+
+Which of those channels actually get read out can be narrowed down at runtime
+with `set_channels()`, default is `INA228_CH_DEFAULT` as far as available.
+
+With `set_snapshot(true)` every sensor gets read out with the conversion-ready
+check of `Adafruit_INA228::readSnapshot()`, so that its registers stem from a
+single conversion cycle. A read that can not be made coherent still delivers,
+but gets counted by `torn()`.
+
+Every read gets accounted per sensor. A blocking read that fails is retried
+`READ_RETRIES` times right away, and a sensor that fails `MAX_FAILURES` reads
+in a row gets marked down: it is left out of the sweeps, so that it costs no
+more bus time, until it is marked up again with `set_up()`. Which sensors
+delivered the results of the last sweep is told by `fresh_mask()`, the others
+keep their previous results in `meas`.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_SensorBank
+#define H_SensorBank
+
+#include <Arduino.h>
+
+#include "Adafruit_INA228.h"
+
+// Maximum number of I2C buses of a bank
+const uint8_t SENSOR_BANK_MAX_BUSES = 2;
+
+// Entry of the sensor table: I2C `address` on I2C bus number `bus`
+constexpr uint16_t on_bus(uint8_t bus, uint8_t address) {
+  return ((uint16_t)bus << 8) | address;
+}
+
+// Number of set bits in `mask`
+constexpr uint8_t count_channels(uint8_t mask) {
+  return mask ? (mask & 1) + count_channels(mask >> 1) : 0;
+}
+
+// [bytes] Length of the result registers selected by `mask` as packed into a
+// binary frame, which carries energy as a 24-bit increment
+constexpr size_t packed_channels_len(uint8_t mask) {
+  return ((mask & INA228_CH_CURRENT) ? 3 : 0) +
+         ((mask & INA228_CH_BUS_VOLTAGE) ? 3 : 0) +
+         ((mask & INA228_CH_ENERGY) ? 3 : 0) +
+         ((mask & INA228_CH_POWER) ? 3 : 0) +
+         ((mask & INA228_CH_DIE_TEMP) ? 2 : 0) +
+         ((mask & INA228_CH_CHARGE) ? 5 : 0);
+}
+
+// Number of sensor table entries on I2C bus number `bus`
+constexpr size_t count_on_bus(uint8_t bus) { return 0; }
+template <typename... Rest>
+constexpr size_t count_on_bus(uint8_t bus, uint16_t sensor, Rest... rest) {
+  return ((sensor >> 8) == bus) + count_on_bus(bus, rest...);
+}
+
+template <uint8_t Channels, uint16_t... Sensors> class SensorBank {
+  static_assert(sizeof...(Sensors) > 0, "Need at least one sensor");
+  static_assert(sizeof...(Sensors) < 32, "Sensor bitmasks hold up to 31");
+  static_assert(Channels != 0, "Need at least one channel");
+  static_assert(count_on_bus(0, Sensors...) + count_on_bus(1, Sensors...) ==
+                    sizeof...(Sensors),
+                "Sensors can only be on bus 0 or 1");
+
+public:
+  static constexpr uint8_t CHANNELS = Channels; // Available channels
+  static constexpr size_t N = sizeof...(Sensors);
+  // Room for the two reads of DIAG_ALRT of a snapshot
+  static constexpr uint8_t N_JOBS_PER_SENSOR = count_channels(Channels) + 2;
+  static constexpr size_t N_JOBS = N * N_JOBS_PER_SENSOR;
+  static constexpr size_t PACKED_LEN = packed_channels_len(Channels);
+  static constexpr uint8_t DEFAULT_CHANNELS =
+      (Channels & INA228_CH_DEFAULT) ? (Channels & INA228_CH_DEFAULT)
+                                     : Channels;
+  static constexpr uint32_t ALL = (1UL << N) - 1; // Bitmask of all sensors
+  static const uint8_t READ_RETRIES = 1; // Retries of a failed blocking read
+  static const uint8_t MAX_FAILURES = 3; // Failed reads in a row until down
+
+  static constexpr uint16_t table[N] = {Sensors...};
+  static constexpr size_t N_ON_BUS[SENSOR_BANK_MAX_BUSES] = {
+      count_on_bus(0, Sensors...), count_on_bus(1, Sensors...)};
+
+  static uint8_t address(size_t i) { return table[i] & 0xFF; }
+  static uint8_t bus(size_t i) { return table[i] >> 8; }
+
+  Adafruit_INA228 sensors[N];
+  INA228_Measurement meas[N];        // Results of the last sweep
+  Adafruit_I2CAsyncJob jobs[N_JOBS]; // Sweep, the jobs of bus 0 first
+
+  // Describe a sweep of the sensors that are up as transfer jobs, once all
+  // sensors got begun
+  void prepare_jobs() {
+    uint8_t n = 0;
+    for (uint8_t b = 0; b < SENSOR_BANK_MAX_BUSES; b++) {
+      _bus_first_job[b] = n;
+      for (size_t i = 0; i < N; i++) {
+        if ((bus(i) == b) && up(i)) {
+          n += _snapshot ? sensors[i].snapshotJobs(&jobs[n], _channels)
+                         : sensors[i].measurementJobs(&jobs[n], _channels);
+        }
+      }
+      _bus_n_jobs[b] = n - _bus_first_job[b];
+    }
+    _stale_jobs = false;
+  }
+
+  // Select the channels to read out from here on, as far as available, and
+  // describe the sweep anew. Returns false if none of them is available.
+  bool set_channels(uint8_t channels) {
+    if ((channels & Channels) == 0) {
+      return false;
+    }
+    _channels = channels & Channels;
+    prepare_jobs();
+    return true;
+  }
+  uint8_t channels() const { return _channels; }
+
+  // Read out coherent snapshots from here on, see `readSnapshot()`, and
+  // describe the sweep anew
+  void set_snapshot(bool snapshot) {
+    _snapshot = snapshot;
+    prepare_jobs();
+  }
+  bool snapshot() const { return _snapshot; }
+
+  // Number of transfer jobs per sensor that is up
+  uint8_t n_sensor_jobs() const {
+    return count_channels(_channels) + (_snapshot ? 2 : 0);
+  }
+
+  // [bytes] Per-sensor length of the packed result registers being read out
+  size_t packed_len() const { return packed_channels_len(_channels); }
+
+  // The part of `jobs` that runs on I2C bus number `b`
+  Adafruit_I2CAsyncJob *bus_jobs(uint8_t b) { return &jobs[_bus_first_job[b]]; }
+  uint8_t n_bus_jobs(uint8_t b) const { return _bus_n_jobs[b]; }
+
+  // Set the clock of I2C bus number `b`, once its sensors got begun
+  bool set_speed(uint8_t b, uint32_t clock) {
+    for (size_t i = 0; i < N; i++) {
+      if (bus(i) == b) {
+        return sensors[i].setI2CSpeed(clock);
+      }
+    }
+    return false;
+  }
+
+  // Blocking sweep over the sensors that are up, returns false if any read
+  // failed
+  bool read() {
+    _fresh = 0;
+    bool ok = read_from(Index<0>());
+    if (_stale_jobs) {
+      prepare_jobs();
+    }
+    return ok;
+  }
+
+  // Blocking read of sensor `i` only, returns false if the read failed or
+  // the sensor is down. Adds to the fresh results since `clear_fresh()`.
+  bool read_one(size_t i) {
+    if (!up(i)) {
+      return false;
+    }
+    bool ok = read_sensor(i);
+    if (_stale_jobs) {
+      prepare_jobs();
+    }
+    return ok;
+  }
+
+  // Account for the finished jobs of bus `b` of a background sweep, of which
+  // the first `n_completed` succeeded. The sensor of the next job failed and
+  // the ones after it did not get read.
+  void jobs_done(uint8_t b, uint8_t n_completed) {
+    uint8_t n_per_sensor = n_sensor_jobs();
+    uint8_t first = 0; // First job of the sensor, counted within the bus
+    for (size_t i = 0; i < N; i++) {
+      if ((bus(i) != b) || !up(i)) {
+        continue;
+      }
+      if (first + n_per_sensor <= n_completed) {
+        account(i, true);
+      } else if (first <= n_completed) {
+        account(i, false);
+      }
+      first += n_per_sensor;
+    }
+  }
+
+  // Decode the receive buffers of the fresh sensors after the jobs of a
+  // background sweep finished. Only then the jobs may get described anew.
+  void decode() {
+    decode_from(Index<0>());
+    if (_stale_jobs) {
+      prepare_jobs();
+    }
+  }
+
+  // Health of the sensors
+  bool up(size_t i) const { return _up & (1UL << i); }
+  uint32_t up_mask() const { return _up; }
+  uint32_t fresh_mask() const { return _fresh; } // Delivered the last results
+  void clear_fresh() { _fresh = 0; }
+  uint32_t errors(size_t i) const { return _errors[i]; } // Failed reads
+  uint32_t torn(size_t i) const { return _torn[i]; } // Incoherent snapshots
+
+  // Sensors that got marked down since the previous call
+  uint32_t take_went_down() {
+    uint32_t mask = _went_down;
+    _went_down = 0;
+    return mask;
+  }
+
+  // Mark sensor `i` up or down, while no sweep is in progress
+  void set_up(size_t i, bool is_up) {
+    _up = is_up ? (_up | (1UL << i)) : (_up & ~(1UL << i));
+    _failures[i] = 0;
+    prepare_jobs();
+  }
+
+private:
+  uint8_t _channels = DEFAULT_CHANNELS; // Channels being read out
+  bool _snapshot = false;               // Read out coherent snapshots?
+  uint8_t _bus_first_job[SENSOR_BANK_MAX_BUSES] = {};
+  uint8_t _bus_n_jobs[SENSOR_BANK_MAX_BUSES] = {};
+  bool _stale_jobs = false; // Describe the jobs anew once no sweep runs
+
+  uint32_t _up = ALL;        // Sensors taking part in the sweeps
+  uint32_t _fresh = 0;       // Sensors that delivered the last results
+  uint32_t _went_down = 0;   // Sensors marked down, see `take_went_down()`
+  uint8_t _failures[N] = {}; // Failed reads in a row
+  uint32_t _errors[N] = {};  // Failed reads in total
+  uint32_t _torn[N] = {};    // Snapshots that mix conversion cycles
+
+  void account(size_t i, bool ok) {
+    if (ok) {
+      _fresh |= 1UL << i;
+      _failures[i] = 0;
+      return;
+    }
+    _errors[i]++;
+    if ((++_failures[i] >= MAX_FAILURES) && up(i)) {
+      _up &= ~(1UL << i);
+      _went_down |= 1UL << i;
+      _stale_jobs = true;
+    }
+  }
+
+  bool read_sensor(size_t i) {
+    bool ok = false;
+    bool coherent = true;
+    for (uint8_t attempt = 0; !ok && (attempt <= READ_RETRIES); attempt++) {
+      ok = _snapshot ? sensors[i].readSnapshot(meas[i], _channels, &coherent)
+                     : sensors[i].readMeasurement(meas[i], _channels);
+    }
+    if (ok && !coherent) {
+      _torn[i]++;
+    }
+    account(i, ok);
+    return ok;
+  }
+
+  template <size_t I> struct Index {};
+
+  bool read_from(Index<N>) { return true; }
+  template <size_t I> bool read_from(Index<I>) {
+    bool ok = !up(I) || read_sensor(I);
+    return read_from(Index<I + 1>()) && ok;
+  }
+
+  void decode_from(Index<N>) {}
+  template <size_t I> void decode_from(Index<I>) {
+    if (_fresh & (1UL << I)) {
+      sensors[I].decodeMeasurement(meas[I], _channels);
+      if (_snapshot && !sensors[I].snapshotCoherent()) {
+        _torn[I]++;
+      }
+    }
+    decode_from(Index<I + 1>());
+  }
+};
+
+template <uint8_t Channels, uint16_t... Sensors>
+constexpr uint16_t SensorBank<Channels, Sensors...>::table[];
+
+template <uint8_t Channels, uint16_t... Sensors>
+constexpr size_t SensorBank<Channels, Sensors...>::N_ON_BUS[];
+
+#endif
@@ -0,0 +1,20 @@
+/*
+The INA228 current sensors of the wind farm: the channels that can be
+selected with the command `ch`, and the I2C addresses. Kept apart from
+`main.cpp` so that the native microbenchmarks run against the very same
+table, see `test/native/test_benchmark`.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_SensorTable
+#define H_SensorTable
+
+#include "SensorBank.h"
+
+// Wrap an address in `on_bus(1, address)` to put that sensor on `Wire1`
+// instead
+typedef SensorBank<INA228_CH_ALL, 0x40, 0x41, 0x44, 0x45, 0x43, 0x4c>
+    INA228Bank;
+
+#endif
@@ -0,0 +1,81 @@
+/*
+Collects outgoing frames and rows into a single buffer to hand them to the
+serial port as one large write. On the native USB of the SAMD51 every write
+ends its bulk transfer with a short packet, so that writing each frame by
+itself wastes most of a 64-byte USB packet and a USB frame of 1 ms per write.
+A write of several packets' worth keeps the packets full instead.
+
+`append()` adds the bytes of a frame when they fit as a whole, frames never
+get split over two writes. `flush()` writes out all that got collected to any
+`Print`. The caller decides when: once the next frame does not fit anymore,
+and once the oldest byte waited long enough according to `due()`, so that a
+slow stream of frames does not stall.
+
+The bytes and writes since `reset_counters()` get counted, to report the
+achieved throughput. The bytes of direct writes can be added with `count()`.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_TxBatch
+#define H_TxBatch
+
+#include <Arduino.h>
+
+template <size_t N> class TxBatch {
+public:
+  // Append `len` bytes from `src`, or nothing when they do not fit
+  bool append(const uint8_t *src, size_t len) {
+    if (len > N - _len) {
+      return false;
+    }
+    if (_len == 0) {
+      _first_us = micros();
+    }
+    memcpy(_data + _len, src, len);
+    _len += len;
+    return true;
+  }
+
+  // Write out the collected bytes in a single write to `out`
+  template <typename Out> void flush(Out &out) {
+    if (_len == 0) {
+      return;
+    }
+    out.write(_data, _len);
+    count(_len);
+    _len = 0;
+  }
+
+  // Time to flush, as the oldest byte waited for `max_age_us`?
+  bool due(uint32_t max_age_us) const {
+    return (_len > 0) && (micros() - _first_us >= max_age_us);
+  }
+
+  // Discard the collected bytes
+  void clear() { _len = 0; }
+
+  size_t size() const { return _len; }
+  size_t capacity() const { return N; }
+
+  // Diagnostics
+  void count(size_t len) {
+    _n_bytes += len;
+    _n_writes++;
+  }
+  uint32_t n_bytes() const { return _n_bytes; }   // Bytes written out
+  uint32_t n_writes() const { return _n_writes; } // Writes to the port
+  void reset_counters() {
+    _n_bytes = 0;
+    _n_writes = 0;
+  }
+
+private:
+  uint8_t _data[N];
+  size_t _len = 0;
+  uint32_t _first_us = 0; // [us] Time of appending the oldest byte
+  uint32_t _n_bytes = 0;
+  uint32_t _n_writes = 0;
+};
+
+#endif
@@ -22,27 +22,73 @@ Dennis van Gils, 14-11-2024
 */
 
 #include <Arduino.h>
+#include <Wire.h>
 
+#include "ActivityMonitor.h"
 #include "Adafruit_INA228.h"
 #include "Adafruit_NeoPixel.h"
+#include "ChannelStats.h"
+#include "ClockSync.h"
+#include "ConfigStore.h"
 #include "DvG_SerialCommand.h"
+#include "EnergyAccumulator.h"
+#include "FramePacking.h"
+#include "LatencyStats.h"
+#include "SampleFrame.h"
+#include "SampleRing.h"
+#include "SensorBank.h"
+#include "SensorTable.h"
+#include "TxBatch.h"
 
-// INA228 current sensors: I2C addresses
-const uint8_t ina228_addresses[] = {0x40, 0x41, 0x44, 0x45, 0x43, 0x4c};
+// INA228 current sensors, see `SensorTable.h`
+INA228Bank ina228_bank;
+const size_t N_sensors = INA228Bank::N;
 
-// INA228 current sensors
-const size_t N_sensors = sizeof(ina228_addresses) / sizeof(ina228_addresses[0]);
-Adafruit_INA228 ina228_sensors[N_sensors];
-
-// [Ohm] Shunt resistor internal to Adafruit INA228
+// [Ohm] Shunt resistor internal to Adafruit INA228, unless calibrated
 const float R_SHUNT = 0.015;
 // [A] Maximum expected current
 const float MAX_CURRENT = 0.2;
-// Shunt full scale ADC range. 0: +/-163.84 mV or 1: +/-40.96 mV.
+// Shunt full scale ADC range, unless saved otherwise. 0: +/-163.84 mV or 1:
+// +/-40.96 mV.
 const uint8_t ADC_RANGE = 1;
 // Prevent resetting the INA228 chip on init?
 const bool SKIP_RESET = true;
 
+// Second I2C bus, for sensors listed as `on_bus(1, address)`. It takes over
+// the SERCOM and pins of `Serial1`, with SDA on TX (D1) and SCL on RX (D0),
+// and needs pull-up resistors of its own. Those pins are already muxed to
+// their SERCOM by the board variant, which `Wire1.begin()` relies on.
+#if defined(_VARIANT_ITSYBITSY_M4_)
+TwoWire Wire1(&sercom3, PIN_SERIAL1_TX, PIN_SERIAL1_RX);
+#  define WIRE1_SERCOM SERCOM3
+#else
+TwoWire Wire1(&sercom5, PIN_SERIAL1_TX, PIN_SERIAL1_RX);
+#  define WIRE1_SERCOM SERCOM5
+#endif
+TwoWire *const i2c_buses[SENSOR_BANK_MAX_BUSES] = {&Wire, &Wire1};
+
+// [Hz] I2C clock per bus. The INA228 supports Fast-mode Plus at 1 MHz when
+// the wiring and pull-ups allow.
+const uint32_t I2C_CLOCK[SENSOR_BANK_MAX_BUSES] = {100000, 100000};
+// [bytes/s] Conservative sustained throughput of the native USB serial link,
+// per transport, see `Transport`
+const uint32_t LINK_THROUGHPUT = 400000;
+const uint32_t LINK_THROUGHPUT_RAW = 800000;
+
+// Digital pin wired to the ALERT output of sensor 0 to acquire on its
+// conversion-ready interrupt, or -1 to poll `conversionReady()` over I2C
+// instead. Any pin with a free external interrupt line will do.
+const int8_t PIN_ALERT = -1;
+
+// Read out the sensors in the background using the non-blocking I2C transfer
+// engine, instead of blocking on `Wire` for the whole sweep? Both buses then
+// transfer at the same time.
+const bool USE_ASYNC_I2C = false;
+
+// Drop into low-power idle while DAQ is off, see `Low-power idle`? Can also
+// be changed at runtime with the commands `idle on` and `idle off`.
+const bool IDLE_LOW_POWER = false;
+
 // Instantiate serial command listener
 #define Ser Serial
 const uint32_t PERIOD_SC = 20; // [ms] Period to listen for serial commands
@@ -52,6 +98,36 @@ DvG_SerialCommand sc(Ser);
 const int BUFLEN = 1024;
 char buf[BUFLEN];
 
+// Sample records waiting to be sent out. Decouples the acquisition from USB
+// back-pressure of a busy host. Must be a power of 2.
+struct SampleRecord {
+  uint32_t seq;      // Sample sequence counter, reset when DAQ turns on
+  uint64_t stamp_us; // Timestamp [us], see `extend_timestamp()`
+  // [us] Data latch time of each sensor relative to `stamp_us`
+  int32_t latch_offsets_us[N_sensors];
+  uint64_t energy[N_sensors]; // [ENERGY counts] Totals of `energy_acc`
+  INA228_Measurement meas[N_sensors];
+  uint8_t slow; // Sensors at the slow profile, see `Adaptive scheduling`
+};
+// Latch offset of a sensor that did not deliver the sample, being down or
+// having failed to read out
+const int32_t LATCH_OFFSET_MISSING = INT32_MIN;
+// Latch offset of a sensor at the slow profile of the adaptive scheduler that
+// had no new data for the sample. Its values repeat its last sample.
+const int32_t LATCH_OFFSET_STALE = INT32_MIN + 1;
+const uint32_t SAMPLE_RING_CAPACITY = 64;
+SampleRing<SampleRecord, SAMPLE_RING_CAPACITY> sample_ring;
+uint32_t sample_seq = 0;
+
+// Output format of the data rows while DAQ is running
+enum StreamMode {
+  STREAM_TEXT,  // Tab-delimited ASCII row with scaled values, for debugging
+  STREAM_BINARY // Packed frame with raw register counts, scaled by the host
+};
+StreamMode stream_mode = STREAM_TEXT;
+
+bool DAQ_running = false;
+
 // Figure out the onboard RGB led, if any
 #if defined(_VARIANT_FEATHER_M4_)
 #  define HAS_DOTSTAR 0
@@ -78,7 +154,12 @@ Adafruit_DotStar led_rgb(DOTSTAR_NUM, PIN_DOTSTAR_DATA, PIN_DOTSTAR_CLK,
 #if HAS_NEOPIXEL || HAS_DOTSTAR
 const uint32_t LED_COLOR_SETUP = led_rgb.Color(0, 0, 6);
 const uint32_t LED_COLOR_IDLE = led_rgb.Color(0, 6, 0);
+const uint32_t LED_COLOR_LOW_POWER = led_rgb.Color(0, 1, 0);
 const uint32_t LED_COLOR_DAQ_RUNNING = led_rgb.Color(6, 6, 0);
+const uint32_t LED_COLOR_SCOPE = led_rgb.Color(0, 6, 6);
+const uint32_t LED_COLOR_OVERFLOW = led_rgb.Color(6, 0, 0);
+const uint32_t LED_COLOR_I2C_ERROR = led_rgb.Color(6, 0, 6);
+const uint32_t LED_COLOR_HOST_LAG = led_rgb.Color(6, 2, 0);
 #endif
 
 /*------------------------------------------------------------------------------
@@ -91,7 +172,8 @@ void get_systick_timestamp(uint32_t *stamp_millis,
   https://github.com/arduino/ArduinoCore-samd/blob/master/cores/arduino/delay.c
 
   Note:
-    The millis counter will roll over after 49.7 days.
+    The millis counter will roll over after 49.7 days, see
+    `extend_timestamp()` for a timestamp that does not.
   */
   // clang-format off
   uint32_t ticks, ticks2;
@@ -119,172 +201,2712 @@ void get_systick_timestamp(uint32_t *stamp_millis,
   // clang-format on
 }
 
+uint64_t extend_timestamp(uint32_t stamp_millis, uint16_t stamp_micros_part) {
+  /* Extend a timestamp as obtained from `get_systick_timestamp()` into a
+  monotonic count of microseconds since boot that, at 64 bits, never rolls
+  over in practice. The rollovers of the millis counter get tracked in here,
+  so it must be called at least once every 24.8 days, which `loop()` takes
+  care of. A stamp taken shortly before a rollover but extended after it,
+  e.g. by an ISR, still comes out right. Safe to call from an ISR.
+  */
+  static uint32_t latest_millis = 0;
+  static uint32_t n_rollovers = 0;
+
+  uint32_t primask = __get_PRIMASK();
+  __disable_irq();
+  uint32_t rollovers = n_rollovers;
+  if ((int32_t)(stamp_millis - latest_millis) >= 0) {
+    if (stamp_millis < latest_millis) {
+      rollovers = ++n_rollovers;
+    }
+    latest_millis = stamp_millis;
+  } else if (stamp_millis > latest_millis) {
+    rollovers--; // Taken before the latest rollover
+  }
+  __set_PRIMASK(primask);
+
+  return ((((uint64_t)rollovers << 32) | stamp_millis) * 1000) +
+         stamp_micros_part;
+}
+
+uint64_t timestamp_us() {
+  // [us] Current time since boot, see `extend_timestamp()`
+  uint32_t stamp_millis;
+  uint16_t stamp_micros_part;
+  get_systick_timestamp(&stamp_millis, &stamp_micros_part);
+  return extend_timestamp(stamp_millis, stamp_micros_part);
+}
+
 /*------------------------------------------------------------------------------
-    setup
+  Time synchronization
+
+  Disciplines the timestamps going out to the clock of the host PC, so that
+  several boards attached to the same host share a common timebase. The sync
+  is a ping/offset protocol driven by the host: it queries `t?` a number of
+  times, takes the midpoint of its own clock before and after the ping with
+  the shortest round trip as the host time at which the Arduino took its
+  stamp, and passes the pair on with `sync <local_us> <host_us>`. Repeating
+  this every so often lets `ClockSync` fit the drift of the crystal as well,
+  and extrapolate the offset in between, also while DAQ is running.
+
+  Only the stamps of the data rows, summaries and scope captures get mapped,
+  all timing inside the firmware stays on the local clock. `t?` therefore
+  keeps reporting local time. `sync?` reports the offset [s] at the latest
+  pair, the drift [ppb], the number of pairs in the fit and the largest
+  residual [us]. `sync r` returns to the local clock.
 ------------------------------------------------------------------------------*/
 
-void setup() {
-  asm(".global _printf_float"); // Enables float support for `snprintf()`
+ClockSync clock_sync;
 
-// Starting setup
-#if HAS_NEOPIXEL || HAS_DOTSTAR
-  led_rgb.begin();
-  led_rgb.setBrightness(255);
-  led_rgb.setPixelColor(0, LED_COLOR_SETUP);
-  led_rgb.show();
-#endif
+uint64_t synced_stamp(uint64_t stamp_us) {
+  // [us] Local timestamp `stamp_us` mapped onto the host clock, when synced
+  return clock_sync.to_host(stamp_us);
+}
 
-  Ser.begin(115200);
-  while (!Ser) { // Wait until serial port is opened
-    delay(10);
+bool parse_sync(uint8_t argc, char **argv) {
+  // `sync <local_us> <host_us>` or `sync r`
+  if ((argc == 2) && (strcmp(argv[1], "r") == 0)) {
+    clock_sync.reset();
+    return true;
   }
+  if ((argc != 3) || !isdigit(argv[1][0]) || !isdigit(argv[2][0])) {
+    return false;
+  }
+  clock_sync.add(strtoull(argv[1], nullptr, 10),
+                 strtoull(argv[2], nullptr, 10));
+  return true;
+}
+
+void report_sync() {
+  // The offset in [s] with microsecond resolution, as it exceeds 32 bits
+  int64_t offset = clock_sync.ref_offset_us;
+  uint64_t magnitude = (offset < 0) ? -offset : offset;
+  snprintf(buf, BUFLEN, "%s%lu.%06lu\t%ld\t%u\t%lu", (offset < 0) ? "-" : "",
+           (uint32_t)(magnitude / 1000000), (uint32_t)(magnitude % 1000000),
+           clock_sync.drift_ppb, clock_sync.n_points, clock_sync.residual_us);
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Timing instrumentation
 
-  uint8_t i = 0;
-  for (auto &ina228 : ina228_sensors) {
-    uint8_t i2c_address = ina228_addresses[i];
+  Cycle-counter probes around each stage of `loop()`, feeding a latency
+  histogram per stage. Dumped by the command `stats?`, one line per stage:
+  name, count, mean [us], max [us] and the counts of the histogram buckets as
+  described in `LatencyStats.h`. Reset with `stats r`.
+------------------------------------------------------------------------------*/
+
+enum Stage {
+  STAGE_LOOP,     // From one pass of `loop()` to the next
+  STAGE_COMMANDS, // Checking for and executing a serial command
+  STAGE_POLL,     // Polling `conversionReady()` over I2C
+  STAGE_TRIGGER,  // Triggering the conversions in triggered mode
+  STAGE_SWEEP,    // From starting the register reads until the results are in
+  STAGE_STORE,    // Decoding and storing the results of a sweep
+  STAGE_SEND,     // Formatting and sending out a record
+  N_STAGES
+};
+const char *const STAGE_NAMES[N_STAGES] = {"loop",  "cmd",   "poll", "trig",
+                                           "sweep", "store", "send"};
+LatencyStats stage_stats[N_STAGES];
+
+void reset_stage_stats() {
+  for (auto &stats : stage_stats) {
+    stats.reset();
+  }
+}
 
-    if (!ina228.begin(i2c_address, &Wire, SKIP_RESET)) {
-      Ser.print("Couldn't find INA228 chip at address 0x");
-      Ser.println(i2c_address, HEX);
-      while (1) {}
+void report_stage_stats() {
+  char line[160];
+  for (uint8_t i = 0; i < N_STAGES; i++) {
+    const LatencyStats &stats = stage_stats[i];
+    snprintf(line, sizeof(line), "%s\t%lu\t%lu\t%lu", STAGE_NAMES[i],
+             stats.count, stats.mean_us(), stats.max_us());
+    for (auto bucket : stats.buckets) {
+      snprintf(line + strlen(line), sizeof(line) - strlen(line), "\t%lu",
+               bucket);
     }
-    // Ser.print("Found INA228 chip at address 0x");
-    // Ser.println(i2c_address, HEX);
-    i++;
+    Ser.println(line);
+  }
+}
 
-    ina228.setShunt(R_SHUNT, MAX_CURRENT);
-    ina228.setADCRange(ADC_RANGE);
-    ina228.setMode(INA228_MODE_CONT_TEMP_BUS_SHUNT);
+/*------------------------------------------------------------------------------
+  INA228 ALERT interrupt
+------------------------------------------------------------------------------*/
 
-    // [#] 1, 4, 16, 64, 128, 256, 512, 1024
-    ina228.setAveragingCount(INA228_COUNT_4);
+volatile bool alert_fired = false;
+volatile uint64_t alert_stamp_us;
 
-    // [us] 50, 84, 150, 280, 540, 1052, 2074, 4120
-    ina228.setCurrentConversionTime(INA228_TIME_4120_us);
-    ina228.setVoltageConversionTime(INA228_TIME_4120_us);
-    ina228.setTemperatureConversionTime(INA228_TIME_50_us);
+void isr_alert() {
+  /* Conversion ready on sensor 0. Timestamp it right here so that the jitter
+  of the main loop does not end up in the sample time.
+  */
+  alert_stamp_us = timestamp_us();
+  alert_fired = true;
+}
 
-    // Report settings to terminal
-    /*
-    Ser.print("ADC range      : ");
-    Ser.println(ina228.getADCRange());
-    Ser.print("Mode           : ");
-    Ser.println(ina228.getMode());
-    Ser.print("Averaging count: ");
-    Ser.println(ina228.getAveragingCount());
-    Ser.print("Current     conversion time: ");
-    Ser.println(ina228.getCurrentConversionTime());
-    Ser.print("Voltage     conversion time: ");
-    Ser.println(ina228.getVoltageConversionTime());
-    Ser.print("Temperature conversion time: ");
-    Ser.println(ina228.getTemperatureConversionTime());
-    Ser.println();
-    */
+/*------------------------------------------------------------------------------
+  Sensor sweep
+
+  Reads out the result registers of all sensors into `ina228_bank.meas`. With
+  `USE_ASYNC_I2C` the reads run in the background while `loop()` keeps
+  serving commands and serial output, otherwise they block on `Wire`.
+------------------------------------------------------------------------------*/
+
+enum SweepState { SWEEP_IDLE, SWEEP_BUSY, SWEEP_DONE };
+SweepState sweep_state = SWEEP_IDLE;
+uint64_t sweep_stamp_us; // Timestamp of the sweep [us]
+uint32_t sweep_cycles;   // Cycle counter at the start of the sweep
+// [us] Data latch time of each sensor relative to `sweep_stamp_us`
+int32_t sweep_latch_offsets_us[N_sensors];
+
+// Transfer engine per bus. `Wire` is on SERCOM2 on both the Feather M4 and
+// the ItsyBitsy M4.
+Adafruit_I2CAsync i2c_async[SENSOR_BANK_MAX_BUSES] = {
+    Adafruit_I2CAsync(SERCOM2), Adafruit_I2CAsync(WIRE1_SERCOM)};
+uint8_t sweep_buses_busy = 0; // Number of buses still transferring
+uint32_t i2c_errors = 0;      // Failed sweeps and sensor reads
+
+size_t first_sensor(uint32_t mask) {
+  // Index of the first sensor in `mask`, or `N_sensors` when empty
+  return mask ? __builtin_ctz(mask) : N_sensors;
+}
+
+size_t last_sensor(uint32_t mask) {
+  // Index of the last sensor in `mask`, or `N_sensors` when empty
+  return mask ? 31 - __builtin_clz(mask) : N_sensors;
+}
+
+void sweep_callback(bool success, void *context) {
+  uint8_t b = (uint8_t)(uintptr_t)context; // Bus number
+  ina228_bank.jobs_done(b, i2c_async[b].completed());
+  if (!success) {
+    i2c_errors++;
+  }
+  if (--sweep_buses_busy == 0) {
+    sweep_state = SWEEP_DONE;
   }
+}
 
-// Finished setup and idle
-#if HAS_NEOPIXEL || HAS_DOTSTAR
-  led_rgb.setPixelColor(0, LED_COLOR_IDLE);
-  led_rgb.show();
-#endif
+void start_sweep(uint64_t stamp_us,
+                 const int32_t *latch_offsets_us = nullptr) {
+  /* Start reading out all sensors that are up. `stamp_us` is the time at
+  which the pacing sensor latched its data, and `latch_offsets_us` the
+  optional latch times of all sensors relative to that, taken as 0 when
+  omitted.
+  */
+  sweep_stamp_us = stamp_us;
+  for (size_t i = 0; i < N_sensors; i++) {
+    sweep_latch_offsets_us[i] = latch_offsets_us ? latch_offsets_us[i] : 0;
+  }
+  sweep_cycles = cycles_now();
+
+  if (USE_ASYNC_I2C) {
+    ina228_bank.clear_fresh();
+    sweep_buses_busy = 0;
+    for (uint8_t b = 0; b < SENSOR_BANK_MAX_BUSES; b++) {
+      sweep_buses_busy += (ina228_bank.n_bus_jobs(b) > 0);
+    }
+    sweep_state = sweep_buses_busy ? SWEEP_BUSY : SWEEP_DONE;
+    for (uint8_t b = 0; b < SENSOR_BANK_MAX_BUSES; b++) {
+      if (ina228_bank.n_bus_jobs(b) > 0) {
+        i2c_async[b].submit(ina228_bank.bus_jobs(b), ina228_bank.n_bus_jobs(b),
+                            sweep_callback, (void *)(uintptr_t)b);
+      }
+    }
+  } else {
+    if (!ina228_bank.read()) {
+      i2c_errors++;
+    }
+    sweep_state = SWEEP_DONE;
+  }
 }
 
 /*------------------------------------------------------------------------------
-    loop
+  Benchmark mode
+
+  Measures the throughput of the pipeline downstream of the sensors: with the
+  command `bench <Hz>` the sweeps no longer wait for a sensor, but get started
+  by a timer at the given rate, or on every pass of `loop()` for a rate of 0,
+  without any I2C traffic. Each such sweep stores the results of the latest
+  real sweep and runs through the ring buffer, the decimation and the
+  serializer exactly like a real one, with the usual sequence counter and
+  timestamp. `bench <Hz>` reads out one real sweep itself, so that the rows
+  carry real values of every sensor that is up, even right after boot. Ticks
+  missed while `loop()` was held up elsewhere get skipped, and show up as
+  gaps in the timestamps. Turned off with `bench off` and reported by
+  `bench?`.
+
+  Together with `ring?` and `stats?` this tells where samples get lost, and
+  the command `t?` returns the current timestamp for the host to measure the
+  round-trip latency of the serial link. See `src_python/benchmark.py`.
 ------------------------------------------------------------------------------*/
 
-void loop() {
-  char *strCmd; // Incoming serial command string
-  static bool DAQ_running = false;
-  bool prev_DAQ_running = DAQ_running;
-  float I; // [mA] Current
-  float V; // [mV] Bus voltage
-  float E; // [J]  Energy
-  // float V_shunt; // [mV] Shunt voltage
-  // float P;       // [mW] Power
-  // float T_die;   // ['C] Die temperature
+bool bench_on = false;
+uint32_t bench_rate = 0;    // [Hz] 0 to run flat out
+uint64_t bench_next_us = 0; // Time of the next tick [us]
 
-  // Time keeping
-  uint32_t millis_copy = millis();
-  uint16_t micros_part;
+bool parse_bench(uint8_t argc, char **argv) {
+  // Parse the command `bench <Hz>` or `bench off`
+  if ((argc == 2) && (strcmp(argv[1], "off") == 0)) {
+    bench_on = false;
+  } else if ((argc == 2) && isdigit(argv[1][0])) {
+    bench_rate = (uint32_t)atol(argv[1]);
+    bench_on = true;
+    bench_next_us = timestamp_us();
+    // Results to repeat, unless a sweep underway is about to leave them
+    if ((sweep_state == SWEEP_IDLE) && !ina228_bank.read()) {
+      i2c_errors++;
+    }
+  } else {
+    return false;
+  }
+  return true;
+}
 
-  /*----------------------------------------------------------------------------
-    Process incoming serial commands every PERIOD_SC milliseconds
-  ----------------------------------------------------------------------------*/
-  static uint32_t tick_sc = millis_copy;
+void report_bench() {
+  if (bench_on) {
+    snprintf(buf, BUFLEN, "%lu", bench_rate);
+    Ser.println(buf);
+  } else {
+    Ser.println("off");
+  }
+}
 
-  if ((millis_copy - tick_sc) > PERIOD_SC) {
-    tick_sc = millis_copy;
-    if (sc.available()) {
-      strCmd = sc.getCmd();
+void run_bench() {
+  // Start a synthetic sweep when the next tick is due, see above
+  uint64_t now_us = timestamp_us();
+  if (bench_rate > 0) {
+    if (now_us < bench_next_us) {
+      return;
+    }
+    uint32_t period_us = 1000000 / bench_rate;
+    bench_next_us += period_us;
+    if (now_us >= bench_next_us) {
+      bench_next_us = now_us + period_us; // Fell behind, skip the missed ticks
+    }
+  }
+  sweep_stamp_us = now_us;
+  for (auto &offset : sweep_latch_offsets_us) {
+    offset = 0;
+  }
+  sweep_cycles = cycles_now();
+  sweep_state = SWEEP_DONE;
+}
 
-      if (strcmp(strCmd, "id?") == 0) {
-        Ser.println("Arduino, Wind Farm");
-        DAQ_running = false;
+/*------------------------------------------------------------------------------
+  Triggered acquisition
 
-      } else if (strcmp(strCmd, "r") == 0) {
-        for (auto &ina228 : ina228_sensors) {
-          ina228.resetAccumulators();
-        }
+  By default all sensors convert free-running and only sensor 0 paces the
+  sweeps, so the other sensors sample at whatever phase their own ADC happens
+  to be in. With the command `trig` all sensors switch to one-shot mode
+  instead and get triggered back to back, one ADC_CONFIG write each, so that
+  their conversion windows line up within the trigger skew. Results are read
+  out once the last triggered sensor is ready, after which the next burst of
+  triggers goes out. The command `cont` returns to free-running conversions.
 
-      } else if (strcmp(strCmd, "on") == 0) {
-        DAQ_running = true;
+  The sample timestamp is the end of the conversion window of sensor 0, i.e.
+  one conversion period after its trigger, when it latches its data. The
+  trigger offsets of the other sensors relative to sensor 0 are reported by
+  the command `skew?` and carry over into their latch offsets.
+------------------------------------------------------------------------------*/
 
-      } else if (strcmp(strCmd, "off") == 0) {
-        DAQ_running = false;
+enum AcquisitionMode {
+  ACQ_CONTINUOUS, // Free-running conversions, paced by sensor 0
+  ACQ_TRIGGERED   // One-shot conversions on all sensors, triggered together
+};
+AcquisitionMode acq_mode = ACQ_CONTINUOUS;
 
-      } else {
-        DAQ_running = !DAQ_running;
-      }
+bool trig_pending = false;        // Triggered, waiting for the conversions
+uint64_t trig_stamp_us;           // Timestamp of the trigger of sensor 0 [us]
+uint32_t trig_offsets[N_sensors]; // [us] Trigger time relative to sensor 0
+uint32_t trig_skew_max = 0;       // [us] Largest trigger spread since DAQ on
+
+bool poll_conversion_ready(Adafruit_INA228 &ina228) {
+  uint32_t t0 = cycles_now();
+  bool ready = ina228.conversionReady();
+  stage_stats[STAGE_POLL].add_since(t0);
+  return ready;
+}
+
+void trigger_all() {
+  uint32_t t0_cycles = cycles_now();
+  trig_stamp_us = timestamp_us();
+  uint32_t t0 = micros();
+
+  for (size_t i = 0; i < N_sensors; i++) {
+    trig_offsets[i] = micros() - t0;
+    if (ina228_bank.up(i)) {
+      ina228_bank.sensors[i].triggerConversion();
     }
   }
 
-  /*----------------------------------------------------------------------------
-    LED indicator
-  ----------------------------------------------------------------------------*/
+  if (trig_offsets[N_sensors - 1] > trig_skew_max) {
+    trig_skew_max = trig_offsets[N_sensors - 1];
+  }
+  trig_pending = true;
+  stage_stats[STAGE_TRIGGER].add_since(t0_cycles);
+}
 
-#if HAS_NEOPIXEL || HAS_DOTSTAR
-  if (DAQ_running != prev_DAQ_running) {
-    prev_DAQ_running = DAQ_running;
-    if (DAQ_running) {
-      led_rgb.setPixelColor(0, LED_COLOR_DAQ_RUNNING);
-      led_rgb.show();
+void report_skew() {
+  // Report the trigger offset of each sensor of the last burst and the
+  // largest trigger spread since DAQ got turned on, all in [us]
+  buf[0] = '\0';
+  for (auto offset : trig_offsets) {
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "%lu\t", offset);
+  }
+  snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "%lu", trig_skew_max);
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Adaptive scheduling
+
+  With the command `sched on` each sensor gets its own ADC settings depending
+  on the activity of its current, see `ActivityMonitor.h`: the settings of
+  `cfg` while active and the slow profile of long conversion times and high
+  averaging while idle, i.e. for a parked turbine or one in a steady wake.
+  The activity gets judged every `SCHED_WINDOW` from the RMS deviation of the
+  current against the threshold set by `sched thr=<mA>`. A sensor turns
+  active on the first window above it and idle after `SCHED_HOLD` windows in
+  a row below it. All sensors start out active on DAQ on. Needs continuous
+  acquisition with the current selected, `sched off` returns all sensors to
+  `cfg`.
+
+  The sensors get timestamped and read out by themselves as with `ts sensor`,
+  paced by the active ones. An idle sensor only gets polled once most of its
+  slow conversion period has passed, and joins the sample when it latched new
+  data by then. Otherwise it is marked `LATCH_OFFSET_STALE`. That way the
+  idle sensors neither hold up the sample nor spend I2C bus time on polls and
+  reads without new data. Every data row carries the bitmask of sensors at
+  the slow profile, see `Binary frame`, and text rows get it as the column
+  `slow` while the scheduler is on. Reported by `sched?`.
+------------------------------------------------------------------------------*/
+
+// Slow profile, applied as far as slower than `cfg`
+const INA228_ConversionTime SCHED_SLOW_CT = INA228_TIME_4120_us;
+const INA228_ConversionTime SCHED_SLOW_VT = INA228_TIME_4120_us;
+const INA228_AveragingCount SCHED_SLOW_AVG = INA228_COUNT_16;
+
+const uint32_t SCHED_WINDOW = 500; // [ms] Window to judge the activity over
+const uint8_t SCHED_HOLD = 4;      // [#] Quiet windows before turning idle
+
+static_assert(N_sensors <= 8, "The bitmask of slow sensors takes one byte");
+
+bool sched_on = false;
+float sched_threshold = 0.5; // [mA] RMS deviation of an active current
+ActivityMonitor activity[N_sensors];
+uint8_t sched_slow = 0;    // Sensors at the slow profile
+uint8_t sched_due = 0;     // Sensors of which the ADC settings are outdated
+uint32_t sched_millis = 0; // Start of the current window [ms]
+
+void reset_sched() {
+  // All sensors start out active again
+  for (auto &monitor : activity) {
+    monitor.reset();
+  }
+  sched_due |= sched_slow;
+  sched_slow = 0;
+  sched_millis = millis();
+}
+
+void sched_add_sweep() {
+  /* Feed the currents of the sensors that delivered the sample to their
+  activity monitors, and judge the activity at the end of the window.
+  */
+  if (!sched_on || !(ina228_bank.channels() & INA228_CH_CURRENT)) {
+    return;
+  }
+  uint32_t fresh = ina228_bank.fresh_mask();
+  for (size_t i = 0; i < N_sensors; i++) {
+    if (fresh & (1UL << i)) {
+      activity[i].add(ina228_bank.meas[i].current);
+    }
+  }
+
+  if (millis() - sched_millis < SCHED_WINDOW) {
+    return;
+  }
+  sched_millis = millis();
+  for (size_t i = 0; i < N_sensors; i++) {
+    if (activity[i].close_window(sched_threshold, SCHED_HOLD)) {
+      sched_slow ^= 1U << i;
+      sched_due |= 1U << i;
+    }
+  }
+}
+
+/*------------------------------------------------------------------------------
+  Per-sensor timestamping
+
+  By default only sensor 0 gets timestamped, after which all sensors get read
+  out in one sweep as if they had latched their data at that same moment. In
+  triggered mode the latch offsets follow from the trigger offsets, but
+  free-running sensors can be up to a whole conversion period out of phase.
+  With the command `ts sensor` each sensor gets polled for conversion-ready by
+  itself instead, and gets timestamped and read out as soon as it latched new
+  data. The sample is complete once all sensors are in, and is timestamped by
+  sensor 0. `ts row` returns to a single timestamp per sample.
+
+  A sensor latched somewhere in between its previous poll and the one that
+  found it ready, so its stamp is taken halfway. The uncertainty is one pass
+  of `loop()`, mostly the polls of all sensors: some 0.5 ms per sensor at
+  100 kHz I2C clock. The reads block, regardless of `USE_ASYNC_I2C`.
+------------------------------------------------------------------------------*/
+
+enum StampMode {
+  STAMP_ROW,   // Timestamp sensor 0 only and sweep all sensors in one go
+  STAMP_SENSOR // Timestamp and read out each sensor as soon as it latched
+};
+StampMode stamp_mode = STAMP_ROW;
+
+uint32_t latch_pending = 0;          // Bitmask of sensors yet to latch
+uint64_t latch_stamps_us[N_sensors]; // [us] Data latch time of each sensor
+uint64_t poll_stamps_us[N_sensors];  // [us] Last conversion-ready poll
+
+bool collect_latches(uint32_t slow = 0, uint32_t slow_poll_us = 0) {
+  /* Poll each sensor that did not latch new data yet, and timestamp and read
+  out the ones that did. Returns true once all sensors that are up are in,
+  after which the next call starts collecting the next sample. Sensors in
+  `slow` do not hold up the sample unless all are slow: they only get polled
+  once `slow_poll_us` passed since they latched last, and join the sample
+  when ready by then.
+  */
+  uint32_t up = ina228_bank.up_mask();
+  if (up == 0) {
+    return false;
+  }
+  uint32_t required = (up & ~slow) ? (up & ~slow) : up;
+  uint32_t optional = up & ~required;
+  if (latch_pending == 0) {
+    latch_pending = required;
+    ina228_bank.clear_fresh();
+  }
+  latch_pending &= required; // Do not wait for a sensor that went down
+
+  for (size_t i = 0; i < N_sensors; i++) {
+    uint32_t bit = 1UL << i;
+    bool due = latch_pending & bit;
+    uint64_t earliest_us = 0; // [us] No latch expected before
+    if ((optional & bit) && !(ina228_bank.fresh_mask() & bit)) {
+      earliest_us = latch_stamps_us[i] + slow_poll_us;
+      due = timestamp_us() >= earliest_us;
+    }
+    if (!due) {
+      continue;
+    }
+    bool ready = poll_conversion_ready(ina228_bank.sensors[i]);
+    uint64_t now_us = timestamp_us();
+    uint64_t prev_us = poll_stamps_us[i] ? poll_stamps_us[i] : now_us;
+    if (prev_us < earliest_us) {
+      prev_us = earliest_us; // Skipped polling until then
+    }
+    poll_stamps_us[i] = now_us;
+    if (!ready) {
+      continue;
+    }
+
+    if (ina228_bank.fresh_mask() == 0) {
+      sweep_cycles = cycles_now();
+    }
+    latch_stamps_us[i] = prev_us + (now_us - prev_us) / 2;
+    if (!ina228_bank.read_one(i)) {
+      i2c_errors++;
+    }
+    latch_pending &= ~bit;
+  }
+
+  return latch_pending == 0;
+}
+
+void latches_to_sweep() {
+  // Hand the collected sample over as if it came from a sweep, timestamped
+  // by the first sensor that delivered
+  size_t ref = first_sensor(ina228_bank.fresh_mask());
+  sweep_stamp_us = latch_stamps_us[ref < N_sensors ? ref : 0];
+  for (size_t i = 0; i < N_sensors; i++) {
+    sweep_latch_offsets_us[i] = (int32_t)(latch_stamps_us[i] - sweep_stamp_us);
+  }
+  sweep_state = SWEEP_DONE;
+}
+
+/*------------------------------------------------------------------------------
+  Energy accumulation
+
+  The 40-bit ENERGY register of every sensor gets folded into a 64-bit total
+  on the MCU, see `EnergyAccumulator.h`, on every sweep that reads it and
+  otherwise every `ENERGY_FOLD_PERIOD`. The data rows carry these totals
+  instead of the register itself: as absolute values in text mode and as
+  increments in binary mode. The totals restart from zero on the command `r`
+  only and are reported by `E?`.
+------------------------------------------------------------------------------*/
+
+const uint32_t ENERGY_FOLD_PERIOD = 1000; // [ms]
+EnergyAccumulator energy_acc[N_sensors];
+uint32_t energy_fold_millis = 0; // Time of the last fold [ms]
+
+void fold_energy_from_sweep() {
+  // Fold in the ENERGY registers as just read out by the sweep
+  if (!(ina228_bank.channels() & INA228_CH_ENERGY)) {
+    return;
+  }
+  uint32_t fresh = ina228_bank.fresh_mask();
+  for (size_t i = 0; i < N_sensors; i++) {
+    if (fresh & (1UL << i)) {
+      energy_acc[i].fold(ina228_bank.meas[i].energy_raw);
+    }
+  }
+  energy_fold_millis = millis();
+}
+
+void fold_energy() {
+  // Read out and fold in the ENERGY registers by themselves
+  INA228_Measurement meas;
+  for (size_t i = 0; i < N_sensors; i++) {
+    if (!ina228_bank.up(i)) {
+      continue;
+    }
+    if (ina228_bank.sensors[i].readMeasurement(meas, INA228_CH_ENERGY)) {
+      energy_acc[i].fold(meas.energy_raw);
     } else {
-      led_rgb.setPixelColor(0, LED_COLOR_IDLE);
-      led_rgb.show();
+      i2c_errors++;
     }
   }
-#endif
+  energy_fold_millis = millis();
+}
 
-  /*----------------------------------------------------------------------------
-    Acquire data
-  ----------------------------------------------------------------------------*/
+void reset_energy() {
+  for (size_t i = 0; i < N_sensors; i++) {
+    ina228_bank.sensors[i].resetAccumulators();
+    energy_acc[i].reset();
+  }
+  energy_fold_millis = millis();
+}
 
-  if (DAQ_running && ina228_sensors[0].conversionReady()) {
-    get_systick_timestamp(&millis_copy, &micros_part);
+/*------------------------------------------------------------------------------
+  Decimation
+
+  Instead of sending out every sample, aggregate them per sensor over a window
+  of `dec_window` samples or milliseconds and send out a single summary row
+  with the mean, minimum, maximum and RMS of the current, bus voltage and
+  power, plus the energy at the end of the window. Selected with the command
+  `dec n=<#>` or `dec t=<ms>`, and turned off again with `dec`.
+------------------------------------------------------------------------------*/
 
-    snprintf(buf, BUFLEN,
-             "%lu\t" // Timestamp millis [ms]
-             "%u",   // Timestamp micros part [us]
-             millis_copy, micros_part);
+enum DecimationMode {
+  DECIMATE_OFF,   // Send out every sample
+  DECIMATE_COUNT, // Window of `dec_window` samples
+  DECIMATE_TIME   // Window of `dec_window` milliseconds
+};
+DecimationMode dec_mode = DECIMATE_OFF;
+uint32_t dec_window = 0;
 
-    for (auto &ina228 : ina228_sensors) {
-      I = ina228.readCurrent();
-      V = ina228.readBusVoltage();
-      E = ina228.readEnergy();
-      // V_shunt = ina228.readShuntVoltage();
-      // P = ina228.readPower();
-      // P = I * V / 1e3;
-      // T_die = ina228.readDieTemp();
+struct SummaryRecord {
+  uint32_t seq;              // Window sequence counter, reset on DAQ on
+  uint64_t stamp_us;         // Timestamp of first sample in the window [us]
+  uint32_t count;            // Number of samples in the window
+  ChannelStats I[N_sensors]; // [mA] Current
+  ChannelStats V[N_sensors]; // [mV] Bus voltage
+  ChannelStats P[N_sensors]; // [mW] Power
+  float E[N_sensors];        // [J]  Energy at the end of the window
+};
+SummaryRecord summary_acc;    // Window being accumulated
+SummaryRecord summary_out;    // Completed window waiting to be sent
+bool summary_pending = false; // Is `summary_out` waiting to be sent?
+uint32_t summary_seq = 0;
+uint32_t summary_dropped = 0; // Windows lost because the host lagged
 
-      snprintf(buf + strlen(buf), BUFLEN - strlen(buf),
-               "\t"
-               "%.2f\t" // I
-               "%.2f\t" // V
-               "%.5f",  // E
-               I, V, E);
+void reset_summary() {
+  summary_acc.count = 0;
+  for (size_t i = 0; i < N_sensors; i++) {
+    summary_acc.I[i].reset();
+    summary_acc.V[i].reset();
+    summary_acc.P[i].reset();
+  }
+}
+
+void accumulate_summary() {
+  if (summary_acc.count == 0) {
+    summary_acc.stamp_us = sweep_stamp_us;
+  }
+  summary_acc.count++;
+
+  // Channels that are not being read out end up as NaN, and sensors that did
+  // not deliver the sample are left out
+  uint8_t channels = ina228_bank.channels();
+  bool has_I = channels & INA228_CH_CURRENT;
+  bool has_V = channels & INA228_CH_BUS_VOLTAGE;
+  uint32_t fresh = ina228_bank.fresh_mask();
+  for (size_t i = 0; i < N_sensors; i++) {
+    const INA228_Measurement &meas = ina228_bank.meas[i];
+    float P = (channels & INA228_CH_POWER)
+                  ? meas.power
+                  : ((has_I && has_V) ? meas.current * meas.bus_voltage / 1e3f
+                                      : NAN);
+    if (fresh & (1UL << i)) {
+      summary_acc.I[i].add(has_I ? meas.current : NAN);
+      summary_acc.V[i].add(has_V ? meas.bus_voltage : NAN);
+      summary_acc.P[i].add(P);
     }
+    uint64_t E_uJ =
+        ina228_bank.sensors[i].energyRawTo_uJ(energy_acc[i].total);
+    summary_acc.E[i] = (channels & INA228_CH_ENERGY) ? E_uJ * 1e-6f : NAN;
+  }
 
-    Ser.println(buf);
+  bool window_done =
+      (dec_mode == DECIMATE_COUNT)
+          ? (summary_acc.count >= dec_window)
+          : (sweep_stamp_us - summary_acc.stamp_us >= dec_window * 1000ULL);
+  if (!window_done) {
+    return;
+  }
+
+  if (summary_pending) {
+    summary_dropped++;
+  } else {
+    summary_out = summary_acc;
+    summary_out.seq = summary_seq;
+    summary_pending = true;
+  }
+  summary_seq++;
+  reset_summary();
+}
+
+bool parse_dec(uint8_t argc, char **argv) {
+  // Parse the command `dec n=<#>`, `dec t=<ms>` or `dec` to turn off
+  if (argc == 1) {
+    dec_mode = DECIMATE_OFF;
+  } else if ((argc == 2) && ((strncmp(argv[1], "n=", 2) == 0) ||
+                             (strncmp(argv[1], "t=", 2) == 0))) {
+    uint32_t window = (uint32_t)parseFloatInString(argv[1], 2);
+    if (window == 0) {
+      return false;
+    }
+    dec_mode = (argv[1][0] == 'n') ? DECIMATE_COUNT : DECIMATE_TIME;
+    dec_window = window;
+  } else {
+    return false;
+  }
+
+  reset_summary();
+  summary_pending = false;
+  return true;
+}
+
+void finish_sweep() {
+  stage_stats[STAGE_SWEEP].add_since(sweep_cycles);
+  if (USE_ASYNC_I2C) {
+    ina228_bank.decode();
+  }
+  sweep_state = SWEEP_IDLE;
+  fold_energy_from_sweep();
+  sched_add_sweep();
+
+  if (dec_mode != DECIMATE_OFF) {
+    accumulate_summary();
+    return;
+  }
+
+  // Hand the sample over to the serializer. The sequence counter advances
+  // for dropped samples too, so that the host can see the gap.
+  SampleRecord *rec = sample_ring.claim();
+  if (rec) {
+    rec->seq = sample_seq;
+    rec->stamp_us = sweep_stamp_us;
+    uint32_t fresh = ina228_bank.fresh_mask();
+    uint32_t stale = sched_slow & ina228_bank.up_mask();
+    for (size_t i = 0; i < N_sensors; i++) {
+      uint32_t bit = 1UL << i;
+      rec->latch_offsets_us[i] = (fresh & bit)   ? sweep_latch_offsets_us[i]
+                                 : (stale & bit) ? LATCH_OFFSET_STALE
+                                                 : LATCH_OFFSET_MISSING;
+      rec->energy[i] = energy_acc[i].total;
+    }
+    memcpy(rec->meas, ina228_bank.meas, sizeof(ina228_bank.meas));
+    rec->slow = sched_slow;
+    sample_ring.commit();
+  }
+  sample_seq++;
+}
+
+/*------------------------------------------------------------------------------
+  Binary frame
+
+  Layout of a single frame, all multi-byte fields are little-endian:
+    [0]  uint16  Sync word 0x5AA5
+    [2]  uint32  Sample sequence counter, reset when DAQ is turned on
+    [6]  uint64  Timestamp [us]
+    [14] uint8   Selected channels, bitmask of `INA228_Channel`
+    [15] uint8   Sensors at the slow profile of the adaptive scheduler
+    [16] Per sensor, the selected channels in this order followed by the
+         latch offset, 13 bytes for the default of current, bus voltage and
+         energy:
+           int24   CURRENT register counts, 20-bit sign-extended
+           uint24  VBUS register counts, 20-bit
+           uint24  Energy increment since the previous frame [ENERGY counts]
+           uint24  POWER register counts
+           int16   DIETEMP register counts
+           int40   CHARGE register counts
+           int32   Latch time relative to the timestamp [us], or INT32_MIN
+                   when the sensor did not deliver this sample, in which case
+                   only its energy increment is meaningful, or INT32_MIN + 1
+                   when it is at the slow profile and had no new data, in
+                   which case its values repeat its last sample
+    [..] uint16  CRC-16/CCITT-FALSE over all bytes following the sync word
+
+  The energy increments add up to the totals of `energy_acc`, starting from
+  the totals reported by the last `E?`. An increment that does not fit in 24
+  bits gets spread over the next frames, so that none gets lost when the
+  host keeps up.
+------------------------------------------------------------------------------*/
+
+// Packed by `pack_sample_frame()` of `SampleFrame.h`
+const size_t BIN_SENSOR_MAX_LEN = INA228Bank::PACKED_LEN + 4;
+const size_t BIN_FRAME_MAX_LEN =
+    BIN_HEADER_LEN + N_sensors * BIN_SENSOR_MAX_LEN + 2;
+
+const uint32_t BIN_ENERGY_MAX_DELTA = 0xFFFFFF;
+uint64_t energy_sent[N_sensors]; // [ENERGY counts] Sum of sent increments
+
+size_t bin_frame_len() {
+  // [bytes] Length of a frame with the selected channels
+  return BIN_HEADER_LEN + N_sensors * (ina228_bank.packed_len() + 4) + 2;
+}
+
+/* Layout of a summary frame when decimating:
+    [0]  uint16  Sync word 0x5AA6
+    [2]  uint32  Window sequence counter, reset when DAQ is turned on
+    [6]  uint64  Timestamp of the first sample in the window [us]
+    [14] uint32  Number of samples in the window
+    [18] Per sensor, 52 bytes of float32:
+           Current [mA]     mean, min, max, rms
+           Bus voltage [mV] mean, min, max, rms
+           Power [mW]       mean, min, max, rms
+           Energy [J]       at the end of the window
+    [..] uint16  CRC-16/CCITT-FALSE over all bytes following the sync word
+*/
+const uint16_t BIN_SYNC_SUMMARY = 0x5AA6;
+const size_t BIN_SUMMARY_HEADER_LEN = 18;
+const size_t BIN_SUMMARY_SENSOR_LEN = 52;
+const size_t BIN_SUMMARY_FRAME_LEN =
+    BIN_SUMMARY_HEADER_LEN + N_sensors * BIN_SUMMARY_SENSOR_LEN + 2;
+
+// Large enough for either frame type
+uint8_t bin_frame[BIN_SUMMARY_FRAME_LEN > BIN_FRAME_MAX_LEN
+                      ? BIN_SUMMARY_FRAME_LEN
+                      : BIN_FRAME_MAX_LEN];
+
+uint8_t *pack_stats(uint8_t *dst, const ChannelStats &stats) {
+  dst = pack_float(dst, stats.mean());
+  dst = pack_float(dst, stats.min);
+  dst = pack_float(dst, stats.max);
+  return pack_float(dst, stats.rms());
+}
+
+/*------------------------------------------------------------------------------
+  Transport
+
+  How the data rows and frames go out over the serial port. The SAMD51 talks
+  native USB at full speed, 12 Mbit/s, whatever the baud rate passed to
+  `Ser.begin()`. What limits the throughput is the number of writes instead:
+  each one ends its bulk transfer with a short packet, and the host only
+  polls for the next one in the next USB frame of 1 ms.
+
+  With transport `cdc`, the default, every row and frame gets written out as
+  soon as it is formatted, which suits a terminal. With transport `raw` they
+  get collected into a batch of `TX_BATCH_LEN` bytes, see `TxBatch.h`, that
+  goes out as a single write once the next frame does not fit anymore, or
+  once its oldest frame waited for `TX_MAX_AGE_US`. Replies to commands do
+  not get batched, the batch goes out ahead of them to keep the order.
+
+  The host negotiates the transport through `id? <transport>`, to which the
+  reply is the usual `Arduino, Wind Farm` followed by a tab and the transport
+  in effect. A firmware that does not know about transports leaves off the
+  tab, and a plain `id?` returns to `cdc`. Reported by `link?`: transport,
+  the achieved throughput [bytes/s], the number of writes per second and the
+  mean number of bytes per write, over the last time DAQ was running.
+------------------------------------------------------------------------------*/
+
+enum Transport { TRANSPORT_CDC, TRANSPORT_RAW, N_TRANSPORTS };
+const char *const TRANSPORT_NAMES[N_TRANSPORTS] = {"cdc", "raw"};
+Transport transport = TRANSPORT_CDC;
+
+const size_t TX_BATCH_LEN = 512;      // [bytes] 8 full-speed USB packets
+const uint32_t TX_MAX_AGE_US = 2000;  // [us] Longest wait of a batched frame
+TxBatch<TX_BATCH_LEN> tx_batch;
+uint64_t link_on_us = 0;  // [us] Time DAQ got turned on
+uint64_t link_off_us = 0; // [us] Time DAQ got turned off, 0 while running
+
+void tx_write(const uint8_t *data, size_t len) {
+  // Send out a frame or row, through the batch when transport is `raw`
+  if (transport == TRANSPORT_RAW) {
+    if (tx_batch.append(data, len)) {
+      return;
+    }
+    tx_batch.flush(Ser);
+    if (tx_batch.append(data, len)) {
+      return;
+    }
   }
-}
\ No newline at end of file
+  Ser.write(data, len);
+  tx_batch.count(len);
+}
+
+void tx_send_buf() {
+  // Send out the ASCII row in `buf` as a line
+  strncat(buf, "\r\n", BUFLEN - strlen(buf) - 1);
+  tx_write((const uint8_t *)buf, strlen(buf));
+}
+
+void tx_service() {
+  // Write out a batch that waited long enough
+  if (tx_batch.due(TX_MAX_AGE_US)) {
+    tx_batch.flush(Ser);
+  }
+}
+
+bool parse_transport(const char *name, Transport *wanted) {
+  for (uint8_t i = 0; i < N_TRANSPORTS; i++) {
+    if (strcmp(name, TRANSPORT_NAMES[i]) == 0) {
+      *wanted = (Transport)i;
+      return true;
+    }
+  }
+  return false;
+}
+
+void set_transport(Transport wanted) {
+  tx_batch.flush(Ser);
+  transport = wanted;
+}
+
+void report_link() {
+  uint64_t end_us = link_off_us ? link_off_us : timestamp_us();
+  uint64_t elapsed_us =
+      (link_on_us && (end_us > link_on_us)) ? end_us - link_on_us : 0;
+  uint32_t n_bytes = tx_batch.n_bytes();
+  uint32_t n_writes = tx_batch.n_writes();
+  uint32_t bytes_per_s =
+      elapsed_us ? (uint32_t)(n_bytes * 1000000ULL / elapsed_us) : 0;
+  uint32_t writes_per_s =
+      elapsed_us ? (uint32_t)(n_writes * 1000000ULL / elapsed_us) : 0;
+  snprintf(buf, BUFLEN, "%s\t%lu\t%lu\t%lu", TRANSPORT_NAMES[transport],
+           bytes_per_s, writes_per_s, n_writes ? n_bytes / n_writes : 0);
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Serializer
+------------------------------------------------------------------------------*/
+
+void append_fixed(int64_t value, uint8_t n_decimals) {
+  /* Append a tab plus `value` * 10^-n_decimals to `buf`, formatted from
+  integers so that the text stream does not need soft-float doubles and
+  keeps the full resolution of the energy accumulator.
+  */
+  static const uint32_t POW10[] = {1, 10, 100, 1000, 10000, 100000, 1000000};
+  uint32_t scale = POW10[n_decimals];
+  uint64_t magnitude = (value < 0) ? -value : value;
+
+  snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%s%lu.%0*lu",
+           (value < 0) ? "-" : "", (uint32_t)(magnitude / scale), n_decimals,
+           (uint32_t)(magnitude % scale));
+}
+
+void append_timestamp(uint64_t stamp_us) {
+  // Append the timestamp in [s] with microsecond resolution to `buf`
+  snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "%lu.%06lu",
+           (uint32_t)(stamp_us / 1000000), (uint32_t)(stamp_us % 1000000));
+}
+
+void send_sample(const SampleRecord &rec) {
+  uint8_t channels = ina228_bank.channels();
+
+  if (stream_mode == STREAM_BINARY) {
+    uint32_t energy_deltas[N_sensors];
+    if (channels & INA228_CH_ENERGY) {
+      for (size_t i = 0; i < N_sensors; i++) {
+        uint64_t delta = rec.energy[i] - energy_sent[i];
+        if (rec.energy[i] < energy_sent[i]) {
+          delta = 0; // Already covered by the totals of `E?`
+        } else if (delta > BIN_ENERGY_MAX_DELTA) {
+          delta = BIN_ENERGY_MAX_DELTA;
+        }
+        energy_sent[i] += delta;
+        energy_deltas[i] = (uint32_t)delta;
+      }
+    }
+
+    size_t len = pack_sample_frame(
+        bin_frame, rec.seq, synced_stamp(rec.stamp_us), channels, rec.slow,
+        N_sensors, rec.meas, energy_deltas, rec.latch_offsets_us);
+    tx_write(bin_frame, len);
+    return;
+  }
+
+  buf[0] = '\0';
+  append_timestamp(synced_stamp(rec.stamp_us));
+  if (sched_on) {
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%u", rec.slow);
+  }
+
+  for (size_t i = 0; i < N_sensors; i++) {
+    Adafruit_INA228 &ina228 = ina228_bank.sensors[i];
+    const INA228_Measurement &meas = rec.meas[i];
+    if (rec.latch_offsets_us[i] == LATCH_OFFSET_MISSING) {
+      // Sensor did not deliver, all but its energy total are unknown
+      for (uint8_t bit = 1; bit <= INA228_CH_ALL; bit <<= 1) {
+        if (!(channels & bit)) {
+          continue;
+        }
+        if (bit == INA228_CH_ENERGY) {
+          append_fixed(ina228.energyRawTo_uJ(rec.energy[i]), 6); // E [J]
+        } else {
+          strncat(buf, "\tnan", BUFLEN - strlen(buf) - 1);
+        }
+      }
+      strncat(buf, "\tnan", BUFLEN - strlen(buf) - 1);
+      continue;
+    }
+    if (channels & INA228_CH_CURRENT) {
+      append_fixed(ina228.currentRawTo_uA(meas.current_raw), 3); // I [mA]
+    }
+    if (channels & INA228_CH_BUS_VOLTAGE) {
+      append_fixed(ina228.busVoltageRawTo_uV(meas.bus_voltage_raw), 3); // [mV]
+    }
+    if (channels & INA228_CH_ENERGY) {
+      append_fixed(ina228.energyRawTo_uJ(rec.energy[i]), 6); // E [J]
+    }
+    if (channels & INA228_CH_POWER) {
+      append_fixed(lroundf(meas.power * 1e3f), 3); // P [mW]
+    }
+    if (channels & INA228_CH_DIE_TEMP) {
+      append_fixed(lroundf(meas.die_temp * 1e2f), 2); // T ['C]
+    }
+    if (channels & INA228_CH_CHARGE) {
+      append_fixed(ina228.chargeRawTo_uC(meas.charge_raw), 6); // Q [C]
+    }
+    if (rec.latch_offsets_us[i] == LATCH_OFFSET_STALE) {
+      strncat(buf, "\tnan", BUFLEN - strlen(buf) - 1); // No new data
+    } else {
+      snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%ld",
+               rec.latch_offsets_us[i]); // Latch offset [us]
+    }
+  }
+
+  tx_send_buf();
+}
+
+void send_summary(const SummaryRecord &sum) {
+  if (stream_mode == STREAM_BINARY) {
+    uint8_t *p = bin_frame;
+    p = pack_le(p, BIN_SYNC_SUMMARY, 2);
+    p = pack_le(p, sum.seq, 4);
+    p = pack_le(p, synced_stamp(sum.stamp_us), 8);
+    p = pack_le(p, sum.count, 4);
+
+    for (size_t i = 0; i < N_sensors; i++) {
+      p = pack_stats(p, sum.I[i]);
+      p = pack_stats(p, sum.V[i]);
+      p = pack_stats(p, sum.P[i]);
+      p = pack_float(p, sum.E[i]);
+    }
+
+    pack_le(p, crc16_ccitt(bin_frame + 2, p - bin_frame - 2), 2);
+    tx_write(bin_frame, BIN_SUMMARY_FRAME_LEN);
+    return;
+  }
+
+  buf[0] = '\0';
+  append_timestamp(synced_stamp(sum.stamp_us)); // Timestamp of first sample
+  snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%lu",
+           sum.count); // Number of samples
+
+  for (size_t i = 0; i < N_sensors; i++) {
+    const ChannelStats *channels[] = {&sum.I[i], &sum.V[i], &sum.P[i]};
+    for (auto ch : channels) {
+      snprintf(buf + strlen(buf), BUFLEN - strlen(buf),
+               "\t%.3f\t%.3f\t%.3f\t%.3f", // mean, min, max, rms
+               ch->mean(), ch->min, ch->max, ch->rms());
+    }
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%.5f", sum.E[i]);
+  }
+
+  tx_send_buf();
+}
+
+void report_energy() {
+  /* Report the energy totals [J] of all sensors. The binary energy increments
+  continue from these.
+  */
+  buf[0] = '\0';
+  for (size_t i = 0; i < N_sensors; i++) {
+    append_fixed(ina228_bank.sensors[i].energyRawTo_uJ(energy_acc[i].total), 6);
+    energy_sent[i] = energy_acc[i].total;
+  }
+  Ser.println(buf + 1); // Skip the leading tab
+}
+
+/*------------------------------------------------------------------------------
+  Channel selection
+
+  The result registers to read out and send for every sensor, selected with
+  the command `ch <letters>` as a comma-separated list of I (current), V (bus
+  voltage), E (energy), P (power), T (die temperature) and Q (charge), e.g.
+  `ch I,V,P`. Selecting P takes the power as computed by the INA228 from the
+  same conversion cycle, instead of the product of I and V. Reported by
+  `ch?`. Unselected registers cost neither I2C bus time nor bytes on the
+  serial link.
+
+  The host learns the layout of the data rows from a header line starting
+  with '#' that lists the column names, sent when DAQ gets turned on and
+  whenever the selection changes while running. Binary frames carry the
+  bitmask of selected channels themselves.
+------------------------------------------------------------------------------*/
+
+// Letter of each channel, in the bit order of `INA228_Channel`
+const char CHANNEL_LETTERS[] = "IVEPTQ";
+
+void send_header() {
+  // Send the column names of the text rows, e.g. `#time\tI_1\tV_1\tdt_1\t..`
+  uint8_t channels = ina228_bank.channels();
+
+  strcpy(buf, sched_on ? "#time\tslow" : "#time");
+  for (size_t i = 0; i < N_sensors; i++) {
+    for (uint8_t bit = 0; CHANNEL_LETTERS[bit] != '\0'; bit++) {
+      if (channels & (1 << bit)) {
+        snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%c_%u",
+                 CHANNEL_LETTERS[bit], i + 1);
+      }
+    }
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\tdt_%u", i + 1);
+  }
+  tx_send_buf(); // In line with the rows
+}
+
+bool parse_channels(char *list, uint8_t *channels) {
+  // Parse a comma-separated list of channel letters into a bitmask
+  *channels = 0;
+  for (char *p = list; *p != '\0'; p++) {
+    if (*p == ',') {
+      continue;
+    }
+    const char *letter = strchr(CHANNEL_LETTERS, toupper(*p));
+    if (letter == NULL) {
+      return false;
+    }
+    *channels |= 1 << (letter - CHANNEL_LETTERS);
+  }
+  return *channels != 0;
+}
+
+void report_channels() {
+  // Report the selected channels as a comma-separated list of letters
+  uint8_t channels = ina228_bank.channels();
+
+  buf[0] = '\0';
+  for (uint8_t bit = 0; CHANNEL_LETTERS[bit] != '\0'; bit++) {
+    if (channels & (1 << bit)) {
+      snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "%s%c",
+               buf[0] ? "," : "", CHANNEL_LETTERS[bit]);
+    }
+  }
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Coherent snapshots
+
+  The INA228 does not auto-increment its register pointer, so the result
+  registers of a sensor get read one by one and a conversion cycle finishing
+  halfway would mix two cycles within one row. By default each sensor gets
+  read out as a snapshot instead, see `Adafruit_INA228::readSnapshot()`: its
+  conversion-ready flag gets cleared before and checked after the reads, and
+  the registers get read again when a cycle finished in between. That costs
+  two extra 2-byte reads per sensor. A snapshot that still mixes cycles, when
+  reading out takes longer than a conversion period, gets counted per sensor.
+  Turned off and on with `snap off` and `snap on`, and reported by `snap?`
+  together with those counts. In triggered mode the sweep only starts after
+  the conversions finished, so the check always passes there.
+------------------------------------------------------------------------------*/
+
+void report_snapshot() {
+  snprintf(buf, BUFLEN, "%s", ina228_bank.snapshot() ? "on" : "off");
+  for (size_t i = 0; i < N_sensors; i++) {
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%lu",
+             ina228_bank.torn(i));
+  }
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  ADC configuration
+
+  Conversion times and averaging count applied to all sensors. Can be changed
+  at runtime with the command `cfg ct=<us> vt=<us> tt=<us> avg=<#>`, where any
+  omitted key keeps its current value.
+------------------------------------------------------------------------------*/
+
+// [us] Allowed conversion times, indexed by `INA228_ConversionTime`
+const uint16_t CONVERSION_TIMES[] = {50, 84, 150, 280, 540, 1052, 2074, 4120};
+// [#] Allowed averaging counts, indexed by `INA228_AveragingCount`
+const uint16_t AVERAGING_COUNTS[] = {1, 4, 16, 64, 128, 256, 512, 1024};
+
+INA228_ConversionTime cfg_ct = INA228_TIME_4120_us;  // Shunt voltage (current)
+INA228_ConversionTime cfg_vt = INA228_TIME_4120_us;  // Bus voltage
+INA228_ConversionTime cfg_tt = INA228_TIME_50_us;    // Die temperature
+INA228_AveragingCount cfg_avg = INA228_COUNT_4;
+
+// Slow profile of the adaptive scheduler, no faster than `cfg`
+INA228_ConversionTime slow_ct() {
+  return (cfg_ct > SCHED_SLOW_CT) ? cfg_ct : SCHED_SLOW_CT;
+}
+INA228_ConversionTime slow_vt() {
+  return (cfg_vt > SCHED_SLOW_VT) ? cfg_vt : SCHED_SLOW_VT;
+}
+INA228_AveragingCount slow_avg() {
+  return (cfg_avg > SCHED_SLOW_AVG) ? cfg_avg : SCHED_SLOW_AVG;
+}
+
+// Keep all sensors in shutdown mode, see `Low-power idle`. The settings of
+// `cfg` still get cached in the meantime.
+bool adc_shutdown = false;
+
+void apply_adc_config(size_t i) {
+  /* Apply the settings of `cfg` to sensor `i`, or the slow profile when the
+  adaptive scheduler found it idle. A single register write, and none when
+  the chip already matches.
+  */
+  bool slow = sched_slow & (1U << i);
+  INA228_MeasurementMode mode = INA228_MODE_SHUTDOWN;
+  if (!adc_shutdown) {
+    mode = (acq_mode == ACQ_TRIGGERED) ? INA228_MODE_TRIG_TEMP_BUS_SHUNT
+                                       : INA228_MODE_CONT_TEMP_BUS_SHUNT;
+  }
+  ina228_bank.sensors[i].setADCConfig(
+      mode, slow ? slow_vt() : cfg_vt, slow ? slow_ct() : cfg_ct, cfg_tt,
+      slow ? slow_avg() : cfg_avg);
+}
+
+void apply_adc_config_all() {
+  for (size_t i = 0; i < N_sensors; i++) {
+    apply_adc_config(i);
+  }
+}
+
+uint32_t conversion_period_us() {
+  /* [us] Time it takes for new conversion results to become available, given
+  that all of bus voltage, shunt voltage and temperature get converted in
+  turn.
+  */
+  return ((uint32_t)CONVERSION_TIMES[cfg_ct] + CONVERSION_TIMES[cfg_vt] +
+          CONVERSION_TIMES[cfg_tt]) *
+         AVERAGING_COUNTS[cfg_avg];
+}
+
+uint32_t slow_conversion_period_us() {
+  // [us] Same as `conversion_period_us()`, for the slow profile
+  return ((uint32_t)CONVERSION_TIMES[slow_ct()] + CONVERSION_TIMES[slow_vt()] +
+          CONVERSION_TIMES[cfg_tt]) *
+         AVERAGING_COUNTS[slow_avg()];
+}
+
+float conversion_rate() {
+  // [Hz] Rate at which new conversion results become available
+  return 1e6f / conversion_period_us();
+}
+
+float max_i2c_rate() {
+  /* [Hz] Maximum rate of sensor sweeps that the slowest I2C bus can sustain.
+  Each register read costs START, address + W, pointer, repeated START,
+  address + R, the data bytes and STOP: 9 bits per byte plus about 3 bits of
+  conditions. One extra 2-byte read per sweep checks or clears the
+  conversion-ready flag, counted on each bus to be safe. The reads of
+  DIAG_ALRT of the snapshots are among the jobs already. In triggered mode
+  every sensor costs an extra 2-byte register write too.
+  */
+  float rate = INFINITY;
+  for (uint8_t b = 0; b < SENSOR_BANK_MAX_BUSES; b++) {
+    uint8_t n_jobs = ina228_bank.n_bus_jobs(b);
+    if (n_jobs == 0) {
+      continue;
+    }
+
+    const Adafruit_I2CAsyncJob *jobs = ina228_bank.bus_jobs(b);
+    uint32_t bits = 9 * (3 + 2) + 3;
+    if (acq_mode == ACQ_TRIGGERED) {
+      bits += INA228Bank::N_ON_BUS[b] * (9 * (2 + 2) + 2);
+    }
+    for (uint8_t i = 0; i < n_jobs; i++) {
+      bits += 9 * (3 + jobs[i].len) + 3;
+    }
+    float bus_rate = (float)I2C_CLOCK[b] / bits;
+    if (bus_rate < rate) {
+      rate = bus_rate;
+    }
+  }
+  return rate;
+}
+
+float max_link_rate() {
+  // [Hz] Maximum rate of rows that the serial link can sustain
+  size_t row_len =
+      (stream_mode == STREAM_BINARY)
+          ? bin_frame_len()
+          : 16 + N_sensors * (6 + 10 * count_channels(ina228_bank.channels()));
+  return (float)((transport == TRANSPORT_RAW) ? LINK_THROUGHPUT_RAW
+                                              : LINK_THROUGHPUT) /
+         row_len;
+}
+
+bool lookup_setting(const uint16_t *table, uint16_t value, uint8_t *index) {
+  // Find the exact `value` in the 8-entry `table`
+  for (uint8_t i = 0; i < 8; i++) {
+    if (table[i] == value) {
+      *index = i;
+      return true;
+    }
+  }
+  return false;
+}
+
+bool parse_cfg(uint8_t argc, char **argv) {
+  /* Parse and apply the command `cfg ct=<us> vt=<us> tt=<us> avg=<#>`. Nothing
+  gets applied when any of the values is invalid.
+  */
+  uint8_t ct = cfg_ct, vt = cfg_vt, tt = cfg_tt, avg = cfg_avg;
+
+  for (uint8_t i = 1; i < argc; i++) {
+    char *token = argv[i];
+    char *eq = strchr(token, '=');
+    if (eq == NULL) {
+      return false;
+    }
+    uint16_t value = (uint16_t)parseFloatInString(token, eq - token + 1);
+    *eq = '\0';
+
+    bool ok;
+    if (strcmp(token, "ct") == 0) {
+      ok = lookup_setting(CONVERSION_TIMES, value, &ct);
+    } else if (strcmp(token, "vt") == 0) {
+      ok = lookup_setting(CONVERSION_TIMES, value, &vt);
+    } else if (strcmp(token, "tt") == 0) {
+      ok = lookup_setting(CONVERSION_TIMES, value, &tt);
+    } else if (strcmp(token, "avg") == 0) {
+      ok = lookup_setting(AVERAGING_COUNTS, value, &avg);
+    } else {
+      ok = false;
+    }
+    if (!ok) {
+      return false;
+    }
+  }
+
+  cfg_ct = (INA228_ConversionTime)ct;
+  cfg_vt = (INA228_ConversionTime)vt;
+  cfg_tt = (INA228_ConversionTime)tt;
+  cfg_avg = (INA228_AveragingCount)avg;
+  apply_adc_config_all();
+  trig_pending = false;
+  latch_pending = 0;
+  return true;
+}
+
+void release_alert() {
+  // Release a pending alert, so that the ALERT pin gets its falling edges
+  // again once the alert paces the sweeps
+  if (PIN_ALERT >= 0) {
+    ina228_bank.sensors[0].alertFunctionFlags();
+    alert_fired = false;
+  }
+}
+
+void set_acq_mode(AcquisitionMode mode) {
+  acq_mode = mode;
+  if (mode == ACQ_TRIGGERED) {
+    sched_on = false; // Paced by the triggers instead
+    reset_sched();
+    sched_due = 0;
+  }
+  apply_adc_config_all();
+  trig_pending = false;
+  latch_pending = 0;
+  release_alert();
+}
+
+void set_stamp_mode(StampMode mode) {
+  stamp_mode = mode;
+  trig_pending = false;
+  latch_pending = 0;
+  release_alert();
+}
+
+void report_cfg() {
+  // Report the active settings, the resulting rate and the bottleneck if any
+  float rate = conversion_rate();
+  float i2c_rate = max_i2c_rate();
+  float link_rate = max_link_rate();
+
+  snprintf(buf, BUFLEN, "ct=%u vt=%u tt=%u avg=%u rate=%.1f Hz",
+           CONVERSION_TIMES[cfg_ct], CONVERSION_TIMES[cfg_vt],
+           CONVERSION_TIMES[cfg_tt], AVERAGING_COUNTS[cfg_avg], rate);
+  if (rate > i2c_rate) {
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf),
+             " WARNING: I2C bus limits to %.1f Hz", i2c_rate);
+  }
+  if (rate > link_rate) {
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf),
+             " WARNING: serial link limits to %.1f Hz", link_rate);
+  }
+  Ser.println(buf);
+}
+
+void apply_sched_due() {
+  // Apply the ADC settings of the sensors that changed profile
+  for (size_t i = 0; i < N_sensors; i++) {
+    if (sched_due & (1U << i)) {
+      apply_adc_config(i);
+    }
+  }
+  sched_due = 0;
+}
+
+bool parse_sched(uint8_t argc, char **argv) {
+  /* Parse and apply the command `sched on|off thr=<mA>`, where either part
+  may be omitted. Nothing gets applied when any of it is invalid.
+  */
+  bool on = sched_on;
+  float threshold = sched_threshold;
+
+  if (argc == 1) {
+    return false;
+  }
+  for (uint8_t i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "on") == 0) {
+      on = true;
+    } else if (strcmp(argv[i], "off") == 0) {
+      on = false;
+    } else if (strncmp(argv[i], "thr=", 4) == 0) {
+      threshold = parseFloatInString(argv[i], 4);
+      if (!(threshold >= 0)) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+  if (on && (acq_mode != ACQ_CONTINUOUS)) {
+    return false;
+  }
+
+  sched_on = on;
+  sched_threshold = threshold;
+  reset_sched();
+  apply_sched_due();
+  latch_pending = 0;
+  release_alert();
+  return true;
+}
+
+void report_sched() {
+  /* Report whether the scheduler is on, the threshold [mA], the bitmask of
+  sensors at the slow profile, the rate [Hz] of the slow profile and the
+  activity [mA] of the last window of every sensor.
+  */
+  snprintf(buf, BUFLEN, "%s\t%.3f\t%u\t%.1f", sched_on ? "on" : "off",
+           sched_threshold, sched_slow, 1e6f / slow_conversion_period_us());
+  for (size_t i = 0; i < N_sensors; i++) {
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%.3f",
+             activity[i].activity);
+  }
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Calibration and persistent configuration
+
+  Each sensor has its own calibration: the resistance of its shunt and a gain
+  correction of its current, set at runtime with the command
+  `cal s=<sensor> r=<Ohm> gain=<factor> range=<0|1>`, where `s` omitted sets
+  all sensors and any other omitted key keeps its current value. `range`
+  selects the shunt full scale ADC range of all sensors. Both corrections go
+  into the SHUNT_CAL register, so that the CURRENT, POWER and ENERGY registers
+  come out calibrated and the current LSB stays the same for the host.
+
+  The command `save` stores the calibration and the ADC configuration in
+  flash, to be applied at boot instead of the defaults, and `save clear`
+  forgets them again from the next boot on. A stored record only applies to
+  the same sensor addresses and the same `MAX_CURRENT`.
+------------------------------------------------------------------------------*/
+
+struct SensorCalibration {
+  float r_shunt; // [Ohm] Resistance of the shunt
+  float gain;    // [-] Correction factor of the current
+};
+
+// Layout in flash, bump the version of `config_store` when changing it
+struct StoredConfig {
+  uint8_t addresses[N_sensors]; // I2C address, plus 0x80 when on `Wire1`
+  float max_current;            // [A] Determines the current LSB
+  uint8_t adc_range;
+  uint8_t ct, vt, tt, avg; // Indices into the ADC configuration tables
+  SensorCalibration cal[N_sensors];
+};
+
+ConfigStore<StoredConfig, 1> config_store;
+SensorCalibration sensor_cal[N_sensors];
+uint8_t adc_range = ADC_RANGE;
+
+void apply_calibration(uint8_t i) {
+  ina228_bank.sensors[i].setCalibration(
+      sensor_cal[i].r_shunt / sensor_cal[i].gain, MAX_CURRENT, adc_range);
+}
+
+uint8_t stored_address(uint8_t i) {
+  return INA228Bank::address(i) | (INA228Bank::bus(i) ? 0x80 : 0);
+}
+
+bool load_config() {
+  /* Take the calibration and ADC configuration from flash, or the defaults
+  when nothing valid got stored. Returns whether the stored one applies.
+  */
+  for (uint8_t i = 0; i < N_sensors; i++) {
+    sensor_cal[i].r_shunt = R_SHUNT;
+    sensor_cal[i].gain = 1;
+  }
+
+  StoredConfig stored;
+  if (!config_store.load(stored) || (stored.max_current != MAX_CURRENT) ||
+      (stored.adc_range > 1) || (stored.ct > 7) || (stored.vt > 7) ||
+      (stored.tt > 7) || (stored.avg > 7)) {
+    return false;
+  }
+  for (uint8_t i = 0; i < N_sensors; i++) {
+    if (stored.addresses[i] != stored_address(i)) {
+      return false;
+    }
+  }
+
+  memcpy(sensor_cal, stored.cal, sizeof(sensor_cal));
+  adc_range = stored.adc_range;
+  cfg_ct = (INA228_ConversionTime)stored.ct;
+  cfg_vt = (INA228_ConversionTime)stored.vt;
+  cfg_tt = (INA228_ConversionTime)stored.tt;
+  cfg_avg = (INA228_AveragingCount)stored.avg;
+  return true;
+}
+
+bool save_config() {
+  StoredConfig stored;
+  memset(&stored, 0, sizeof(stored)); // Defined padding for the CRC
+  for (uint8_t i = 0; i < N_sensors; i++) {
+    stored.addresses[i] = stored_address(i);
+  }
+  stored.max_current = MAX_CURRENT;
+  stored.adc_range = adc_range;
+  stored.ct = cfg_ct;
+  stored.vt = cfg_vt;
+  stored.tt = cfg_tt;
+  stored.avg = cfg_avg;
+  memcpy(stored.cal, sensor_cal, sizeof(sensor_cal));
+  return config_store.save(stored);
+}
+
+bool parse_cal(uint8_t argc, char **argv) {
+  /* Parse and apply the command `cal s=<sensor> r=<Ohm> gain=<factor>
+  range=<0|1>`. Nothing gets applied when any of the values is invalid.
+  */
+  int sensor = -1;
+  float r_shunt = NAN, gain = NAN;
+  uint8_t range = adc_range;
+
+  for (uint8_t i = 1; i < argc; i++) {
+    char *token = argv[i];
+    char *eq = strchr(token, '=');
+    if (eq == NULL) {
+      return false;
+    }
+    float value = parseFloatInString(token, eq - token + 1);
+    *eq = '\0';
+
+    if (strcmp(token, "s") == 0) {
+      sensor = (int)value;
+      if ((sensor < 0) || (sensor >= (int)N_sensors)) {
+        return false;
+      }
+    } else if ((strcmp(token, "r") == 0) && (value > 0)) {
+      r_shunt = value;
+    } else if ((strcmp(token, "gain") == 0) && (value > 0)) {
+      gain = value;
+    } else if ((strcmp(token, "range") == 0) && (value == 0 || value == 1)) {
+      range = (uint8_t)value;
+    } else {
+      return false;
+    }
+  }
+
+  adc_range = range;
+  for (uint8_t i = 0; i < N_sensors; i++) {
+    if ((sensor < 0) || (sensor == i)) {
+      if (!isnan(r_shunt)) {
+        sensor_cal[i].r_shunt = r_shunt;
+      }
+      if (!isnan(gain)) {
+        sensor_cal[i].gain = gain;
+      }
+    }
+    apply_calibration(i);
+  }
+  return true;
+}
+
+void report_cal() {
+  // Report the ADC range, followed by resistance and gain of each sensor
+  snprintf(buf, BUFLEN, "range=%u", adc_range);
+  for (uint8_t i = 0; i < N_sensors; i++) {
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "\t%.6f,%.6f",
+             sensor_cal[i].r_shunt, sensor_cal[i].gain);
+  }
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Sensor health
+
+  A sensor that stops responding, e.g. by a loose cable, gets marked down by
+  `ina228_bank` after a few failed reads in a row, see `SensorBank.h`. It is
+  then left out of the acquisition while the others carry on, and is marked
+  as missing in the data rows: `nan` in text mode and a latch offset of
+  INT32_MIN in binary mode. The same goes for a sensor that is absent at boot.
+
+  Right after a sensor went down its bus gets recovered, in case a sensor
+  that got interrupted halfway a transfer holds SDA low: SCL gets clocked
+  until SDA is released, after which a STOP condition resets the bus. Every
+  `REPROBE_PERIOD` ms one of the sensors that are down gets probed again, at
+  the cost of a single address byte when it is still absent. Once it
+  responds it gets configured and rejoins the acquisition. The command
+  `health?` reports the state and the number of failed reads of each sensor.
+------------------------------------------------------------------------------*/
+
+const uint32_t REPROBE_PERIOD = 1000; // [ms]
+uint32_t reprobe_millis = 0;          // Time of the last probe [ms]
+uint8_t reprobe_next = 0;             // Sensor to consider probing next
+
+bool begin_sensor(uint8_t i) {
+  /* (Re)connect to sensor `i` and configure it. Returns false when it does
+  not respond. Note that this resets the clock of its bus.
+  */
+  Adafruit_INA228 &ina228 = ina228_bank.sensors[i];
+  bool found = ina228.begin(INA228Bank::address(i),
+                            i2c_buses[INA228Bank::bus(i)], SKIP_RESET);
+  apply_calibration(i); // Also sets the scaling of an absent sensor
+  if (!found) {
+    return false;
+  }
+  apply_adc_config(i);
+
+  // Latch the conversion-ready alert so that every conversion produces a
+  // fresh falling edge once the flags got cleared by reading DIAG_ALRT
+  if ((PIN_ALERT >= 0) && (i == 0)) {
+    ina228.setAlertPolarity(INA228_ALERT_POLARITY_NORMAL);
+    ina228.setAlertLatch(INA228_ALERT_LATCH_ENABLED);
+    ina228.setConversionReadyAlert(true);
+  }
+  return true;
+}
+
+void recover_bus(uint8_t b) {
+  // Free I2C bus number `b` from a sensor holding SDA low, then hand the
+  // pins back to its SERCOM
+  const uint8_t sda = b ? PIN_SERIAL1_TX : PIN_WIRE_SDA;
+  const uint8_t scl = b ? PIN_SERIAL1_RX : PIN_WIRE_SCL;
+
+  // Open-drain by hand: drive low as output, release as input
+  pinMode(sda, INPUT_PULLUP);
+  pinMode(scl, INPUT_PULLUP);
+  for (uint8_t pulse = 0; (pulse < 9) && !digitalRead(sda); pulse++) {
+    pinMode(scl, OUTPUT);
+    digitalWrite(scl, LOW);
+    delayMicroseconds(5);
+    pinMode(scl, INPUT_PULLUP);
+    delayMicroseconds(5);
+  }
+  pinMode(sda, OUTPUT); // STOP: SDA rises while SCL is high
+  digitalWrite(sda, LOW);
+  delayMicroseconds(5);
+  pinMode(sda, INPUT_PULLUP);
+  delayMicroseconds(5);
+
+  i2c_buses[b]->begin();
+  ina228_bank.set_speed(b, I2C_CLOCK[b]);
+}
+
+void service_health(uint32_t now) {
+  /* Recover the buses of sensors that just went down, and probe the next
+  sensor that is down once per `REPROBE_PERIOD`. Only call while no sweep
+  and no scope capture is in progress.
+  */
+  uint32_t went_down = ina228_bank.take_went_down();
+  for (uint8_t b = 0; b < SENSOR_BANK_MAX_BUSES; b++) {
+    for (size_t i = 0; i < N_sensors; i++) {
+      if ((went_down & (1UL << i)) && (INA228Bank::bus(i) == b)) {
+        recover_bus(b);
+        break;
+      }
+    }
+  }
+
+  if ((ina228_bank.up_mask() == INA228Bank::ALL) ||
+      (now - reprobe_millis < REPROBE_PERIOD)) {
+    return;
+  }
+  reprobe_millis = now;
+
+  // Round robin over the sensors that are down, one probe per period
+  for (size_t n = 0; n < N_sensors; n++) {
+    uint8_t i = reprobe_next;
+    reprobe_next = (reprobe_next + 1) % N_sensors;
+    if (ina228_bank.up(i)) {
+      continue;
+    }
+    uint8_t b = INA228Bank::bus(i);
+    if (begin_sensor(i)) {
+      ina228_bank.set_up(i, true);
+    }
+    ina228_bank.set_speed(b, I2C_CLOCK[b]);
+    break;
+  }
+}
+
+void report_health() {
+  // Report per sensor whether it is up or down and its failed reads so far
+  buf[0] = '\0';
+  for (size_t i = 0; i < N_sensors; i++) {
+    snprintf(buf + strlen(buf), BUFLEN - strlen(buf), "%s%s/%lu",
+             i ? "\t" : "", ina228_bank.up(i) ? "up" : "down",
+             ina228_bank.errors(i));
+  }
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Scope mode
+
+  Captures a single channel of a single sensor as fast as the I2C bus allows
+  into a block of SRAM, around a trigger event. Armed with the command
+
+    scope ch=<I|V> trig=<rise|fall|step> thr=<value> pre=<#> s=<sensor>
+
+  where any omitted key keeps its current value. The threshold is in [mA] for
+  the current and in [mV] for the bus voltage. `rise` and `fall` trigger when
+  the channel crosses the threshold in that direction and `step` when it
+  changes by at least the threshold from one sample to the next. `pre` sets
+  the number of samples to keep from before the trigger.
+
+  Arming turns DAQ off and switches the sensor to continuous conversions of
+  only that channel at 50 us without averaging. The register gets read back
+  to back without checking for conversion-ready, so at an I2C clock below
+  about 1 MHz the bus is the limit and every sample is a fresh conversion.
+  The sampling runs in slices of `SCOPE_SLICE_US`, so that serial commands
+  keep being served: `scope?` reports the state and `scope off` aborts.
+
+  Once the block is full, the sensor returns to its ADC configuration and
+  the capture goes out as scope frames, one per pass of `loop()`, regardless
+  of the stream mode:
+    [0]  uint16  Sync word 0x5AA7
+    [2]  uint16  Index of this frame within the capture
+    [4]  uint16  Number of frames of the capture
+    [6]  uint8   Channel, `INA228_CH_CURRENT` or `INA228_CH_BUS_VOLTAGE`
+    [7]  uint8   Sensor index
+    [8]  uint64  Timestamp of the trigger [us]
+    [16] 32 samples of:
+           int32   Time relative to the trigger [us]
+           int32   Value [uA] or [uV]
+    [..] uint16  CRC-16/CCITT-FALSE over all bytes following the sync word
+------------------------------------------------------------------------------*/
+
+enum ScopeState {
+  SCOPE_IDLE,      // Not capturing
+  SCOPE_ARMED,     // Sampling into the pre-trigger history
+  SCOPE_TRIGGERED, // Sampling until the block is full
+  SCOPE_DUMPING    // Sending out the block
+};
+const char *const SCOPE_STATE_NAMES[] = {"idle", "armed", "triggered",
+                                         "dumping"};
+
+enum ScopeTrigger { SCOPE_RISE, SCOPE_FALL, SCOPE_STEP };
+const char *const SCOPE_TRIGGER_NAMES[] = {"rise", "fall", "step"};
+
+struct ScopeSample {
+  uint32_t cycles; // Cycle counter at the read
+  int32_t value;   // [uA] or [uV]
+};
+
+const uint32_t SCOPE_CAPACITY = 8192; // [samples] 64 kB, must be a power of 2
+const uint16_t SCOPE_FRAME_SAMPLES = 32;
+const uint16_t SCOPE_N_FRAMES = SCOPE_CAPACITY / SCOPE_FRAME_SAMPLES;
+const uint32_t SCOPE_SLICE_US = 2000; // Sampling time per pass of `loop()`
+ScopeSample scope_buf[SCOPE_CAPACITY];
+
+ScopeState scope_state = SCOPE_IDLE;
+uint8_t scope_channel = INA228_CH_CURRENT;
+ScopeTrigger scope_trigger = SCOPE_STEP;
+int32_t scope_threshold = 10000; // [uA] or [uV]
+uint32_t scope_pre = SCOPE_CAPACITY / 4;
+uint8_t scope_sensor = 0;
+
+uint32_t scope_head;       // Number of samples taken since arming
+uint32_t scope_trig_index; // Sample number of the trigger
+uint32_t scope_trig_cycles;
+uint64_t scope_trig_stamp_us;
+uint16_t scope_frame_index; // Next frame to send out
+int32_t scope_prev_value;
+
+const uint16_t BIN_SYNC_SCOPE = 0x5AA7;
+const size_t BIN_SCOPE_HEADER_LEN = 16;
+const size_t BIN_SCOPE_FRAME_LEN =
+    BIN_SCOPE_HEADER_LEN + SCOPE_FRAME_SAMPLES * 8 + 2;
+static_assert(BIN_SCOPE_FRAME_LEN <= sizeof(bin_frame),
+              "Scope frame must fit the frame buffer");
+
+void arm_scope() {
+  Adafruit_INA228 &ina228 = ina228_bank.sensors[scope_sensor];
+  bool current = (scope_channel == INA228_CH_CURRENT);
+
+  ina228.setADCConfig(current ? INA228_MODE_CONT_SHUNT : INA228_MODE_CONT_BUS,
+                      INA228_TIME_50_us, INA228_TIME_50_us, cfg_tt,
+                      INA228_COUNT_1);
+
+  scope_head = 0;
+  scope_state = SCOPE_ARMED;
+}
+
+void stop_scope() {
+  // Return the sensor to the regular acquisition
+  apply_adc_config(scope_sensor);
+  trig_pending = false;
+  latch_pending = 0;
+}
+
+void abort_scope() {
+  if ((scope_state == SCOPE_ARMED) || (scope_state == SCOPE_TRIGGERED)) {
+    stop_scope();
+  }
+  scope_state = SCOPE_IDLE;
+}
+
+bool scope_triggers(int32_t value) {
+  switch (scope_trigger) {
+    case SCOPE_RISE:
+      return (scope_prev_value < scope_threshold) && (value >= scope_threshold);
+    case SCOPE_FALL:
+      return (scope_prev_value > scope_threshold) && (value <= scope_threshold);
+    default:
+      return labs(value - scope_prev_value) >= scope_threshold;
+  }
+}
+
+void scope_acquire() {
+  // Sample for one slice, checking for the trigger while armed
+  Adafruit_INA228 &ina228 = ina228_bank.sensors[scope_sensor];
+  bool current = (scope_channel == INA228_CH_CURRENT);
+  uint32_t t0 = cycles_now();
+
+  do {
+    ScopeSample &sample = scope_buf[scope_head & (SCOPE_CAPACITY - 1)];
+    sample.cycles = cycles_now();
+    sample.value = current
+                       ? ina228.currentRawTo_uA(ina228.readCurrentRaw())
+                       : (int32_t)ina228.busVoltageRawTo_uV(
+                             ina228.readBusVoltageRaw());
+
+    if (scope_state == SCOPE_ARMED) {
+      // Only once the pre-trigger history is complete
+      if ((scope_head >= scope_pre) && (scope_head > 0) &&
+          scope_triggers(sample.value)) {
+        scope_trig_index = scope_head;
+        scope_trig_cycles = sample.cycles;
+        scope_trig_stamp_us = timestamp_us();
+        scope_state = SCOPE_TRIGGERED;
+      }
+    }
+    scope_prev_value = sample.value;
+    scope_head++;
+
+    if ((scope_state == SCOPE_TRIGGERED) &&
+        (scope_head - scope_trig_index >= SCOPE_CAPACITY - scope_pre)) {
+      stop_scope();
+      scope_frame_index = 0;
+      scope_state = SCOPE_DUMPING;
+      return;
+    }
+  } while (cycles_now() - t0 < SCOPE_SLICE_US * LatencyStats::CYCLES_PER_US);
+}
+
+void send_scope_frame() {
+  uint32_t first = scope_trig_index - scope_pre +
+                   (uint32_t)scope_frame_index * SCOPE_FRAME_SAMPLES;
+
+  uint8_t *p = bin_frame;
+  p = pack_le(p, BIN_SYNC_SCOPE, 2);
+  p = pack_le(p, scope_frame_index, 2);
+  p = pack_le(p, SCOPE_N_FRAMES, 2);
+  p = pack_le(p, scope_channel, 1);
+  p = pack_le(p, scope_sensor, 1);
+  p = pack_le(p, synced_stamp(scope_trig_stamp_us), 8);
+
+  for (uint32_t i = first; i < first + SCOPE_FRAME_SAMPLES; i++) {
+    const ScopeSample &sample = scope_buf[i & (SCOPE_CAPACITY - 1)];
+    int32_t t_us = (int32_t)(sample.cycles - scope_trig_cycles) /
+                   (int32_t)LatencyStats::CYCLES_PER_US;
+    p = pack_le(p, (uint32_t)t_us, 4);
+    p = pack_le(p, (uint32_t)sample.value, 4);
+  }
+
+  pack_le(p, crc16_ccitt(bin_frame + 2, p - bin_frame - 2), 2);
+  tx_write(bin_frame, BIN_SCOPE_FRAME_LEN);
+
+  if (++scope_frame_index == SCOPE_N_FRAMES) {
+    scope_state = SCOPE_IDLE;
+  }
+}
+
+void run_scope() {
+  if ((scope_state == SCOPE_ARMED) || (scope_state == SCOPE_TRIGGERED)) {
+    scope_acquire();
+  } else if (scope_state == SCOPE_DUMPING) {
+    send_scope_frame();
+  }
+}
+
+bool parse_scope(uint8_t argc, char **argv) {
+  /* Parse the arguments of `scope ch=<I|V> trig=<rise|fall|step> thr=<value>
+  pre=<#> s=<sensor>`. Nothing gets applied when any of them is invalid.
+  */
+  uint8_t channel = scope_channel;
+  uint8_t trigger = scope_trigger;
+  float threshold = scope_threshold / 1e3f;
+  uint32_t pre = scope_pre;
+  uint8_t sensor = scope_sensor;
+
+  for (uint8_t i = 1; i < argc; i++) {
+    char *token = argv[i];
+    char *eq = strchr(token, '=');
+    if (eq == NULL) {
+      return false;
+    }
+    *eq = '\0';
+    char *value = eq + 1;
+
+    if (strcmp(token, "ch") == 0) {
+      if (strcmp(value, "I") == 0) {
+        channel = INA228_CH_CURRENT;
+      } else if (strcmp(value, "V") == 0) {
+        channel = INA228_CH_BUS_VOLTAGE;
+      } else {
+        return false;
+      }
+    } else if (strcmp(token, "trig") == 0) {
+      for (trigger = 0; trigger < 3; trigger++) {
+        if (strcmp(value, SCOPE_TRIGGER_NAMES[trigger]) == 0) {
+          break;
+        }
+      }
+      if (trigger == 3) {
+        return false;
+      }
+    } else if (strcmp(token, "thr") == 0) {
+      threshold = atof(value);
+    } else if (strcmp(token, "pre") == 0) {
+      pre = atol(value);
+      if (pre >= SCOPE_CAPACITY) {
+        return false;
+      }
+    } else if (strcmp(token, "s") == 0) {
+      sensor = atoi(value);
+      if (sensor >= N_sensors) {
+        return false;
+      }
+    } else {
+      return false;
+    }
+  }
+
+  scope_channel = channel;
+  scope_trigger = (ScopeTrigger)trigger;
+  scope_threshold = lroundf(threshold * 1e3f);
+  scope_pre = pre;
+  scope_sensor = sensor;
+  return true;
+}
+
+void report_scope() {
+  // Report the state, the settings and the number of samples taken
+  snprintf(buf, BUFLEN, "%s ch=%c trig=%s thr=%.3f pre=%lu s=%u n=%lu",
+           SCOPE_STATE_NAMES[scope_state],
+           (scope_channel == INA228_CH_CURRENT) ? 'I' : 'V',
+           SCOPE_TRIGGER_NAMES[scope_trigger], scope_threshold / 1e3f,
+           scope_pre, scope_sensor, scope_head);
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Low-power idle
+
+  For battery-powered deployments, the board can drop into a low-power idle
+  state while DAQ is off. Turned on and off with `idle on` and `idle off`,
+  and on from boot by `IDLE_LOW_POWER`. Once DAQ has been off for
+  `IDLE_DELAY` and no scope capture is going on, all sensors go into
+  shutdown mode, drawing a few uA instead of some 0.6 mA each, and the core
+  sleeps between interrupts. That is the IDLE sleep mode of the SAMD51, in
+  which the clocks of the USB and the SysTick keep running: the core wakes on
+  every USB event and every millisecond tick, so commands get through and
+  the timekeeping goes on. Standby would stop the USB.
+
+  Commands get served as usual, and changes to the ADC configuration get
+  cached while the sensors stay shut down. `on` and arming the scope wake the
+  board up: the cached configuration gets written back, a single register
+  write per sensor, and reading DIAG_ALRT drops any conversion-ready flag left
+  over from before the shutdown. The first sample follows one conversion
+  period later. Energy and charge do not accumulate while the sensors are
+  shut down, so that their periodic fold gets skipped as well, and the `loop`
+  stage of `stats?` includes the sleep.
+
+  Reported by `idle?`: on or off, whether idling right now, the time it took
+  to write back the configuration when the last `on` woke the board [us], or
+  0 when it did not have to, and the time from the last `on` to its first
+  sample [us], or 0 while still waiting for it.
+------------------------------------------------------------------------------*/
+
+const uint32_t IDLE_DELAY = 1000; // [ms] DAQ off for this long before idling
+
+bool idle_on = IDLE_LOW_POWER;
+bool idle_active = false;          // Sensors shut down and core sleeping?
+uint32_t idle_busy_millis = 0;     // [ms] Last time anything kept it awake
+uint64_t wake_on_us = 0;           // [us] Time of the last `on`
+bool wake_pending = false;         // Waiting for the first sample after `on`?
+uint32_t wake_restore_us = 0;      // [us] Writing back the configuration
+uint32_t wake_first_sample_us = 0; // [us] From the last `on` to its sample
+
+void apply_adc_config_up() {
+  // Sensors that are down get configured once they are probed back up
+  for (size_t i = 0; i < N_sensors; i++) {
+    if (ina228_bank.up(i)) {
+      apply_adc_config(i);
+    }
+  }
+}
+
+void enter_idle() {
+  idle_active = true;
+  adc_shutdown = true;
+  apply_adc_config_up();
+
+  // Takes effect once read back, as per the datasheet
+  PM->SLEEPCFG.reg = PM_SLEEPCFG_SLEEPMODE_IDLE;
+  while (PM->SLEEPCFG.bit.SLEEPMODE != PM_SLEEPCFG_SLEEPMODE_IDLE_Val) {}
+}
+
+void wake_from_idle() {
+  // Restore the cached ADC configuration of all sensors, when idling
+  if (!idle_active) {
+    return;
+  }
+  uint64_t t0 = timestamp_us();
+  idle_active = false;
+  adc_shutdown = false;
+  apply_adc_config_up();
+  for (size_t i = 0; i < N_sensors; i++) {
+    if (ina228_bank.up(i)) {
+      ina228_bank.sensors[i].alertFunctionFlags();
+    }
+  }
+  alert_fired = false;
+  wake_restore_us = (uint32_t)(timestamp_us() - t0);
+  idle_busy_millis = millis();
+}
+
+void service_idle(uint32_t now) {
+  // Enter idle once DAQ has been off for long enough and the bus is free
+  if (!idle_on || DAQ_running || (scope_state != SCOPE_IDLE) ||
+      (sweep_state != SWEEP_IDLE)) {
+    idle_busy_millis = now;
+  } else if (!idle_active && (now - idle_busy_millis >= IDLE_DELAY)) {
+    enter_idle();
+  }
+}
+
+void idle_sleep() {
+  /* Sleep until the next interrupt when idling, unless anything is waiting
+  to go out or came in. A command arriving just before the sleep gets served
+  at the next millisecond tick.
+  */
+  if (idle_active && (tx_batch.size() == 0) && !Ser.available()) {
+    __DSB();
+    __WFI();
+  }
+}
+
+void note_first_sample() {
+  if (wake_pending) {
+    wake_pending = false;
+    wake_first_sample_us = (uint32_t)(timestamp_us() - wake_on_us);
+  }
+}
+
+void report_idle() {
+  snprintf(buf, BUFLEN, "%s\t%u\t%lu\t%lu", idle_on ? "on" : "off",
+           idle_active, wake_restore_us,
+           wake_pending ? 0 : wake_first_sample_us);
+  Ser.println(buf);
+}
+
+/*------------------------------------------------------------------------------
+  Status LED
+
+  The color shows the state: blue during setup, green when idle, yellow while
+  DAQ is running and cyan in scope mode. For `LED_FAULT_HOLD` ms after a
+  problem the LED blinks between that color and the color of the problem, by
+  priority: magenta for a failed I2C transfer, red for samples lost to a full
+  ring buffer and orange for a host lagging behind, i.e. a ring buffer over
+  half full.
+
+  Writing the NeoPixel of the Feather M4 bit-bangs the WS2812 protocol with
+  interrupts disabled for some 30 us, and the DotStar of the ItsyBitsy M4
+  takes about as long with interrupts enabled. Both would delay a sample. So
+  `led_update()` only works out the color and the write waits for a gap of at
+  least `LED_GAP_US` before the next conversion result is due, or right after
+  a sweep once it got deferred for `LED_MAX_DEFER` ms when the conversions
+  follow each other too fast for such a gap. During a scope capture the LED
+  is left alone altogether.
+------------------------------------------------------------------------------*/
+
+#if HAS_NEOPIXEL || HAS_DOTSTAR
+const uint32_t LED_FAULT_HOLD = 2000;  // [ms] Keep signaling a past problem
+const uint32_t LED_BLINK_PERIOD = 250; // [ms] Half a period of blinking
+const uint32_t LED_GAP_US = 100;       // [us] Quiet time needed for a write
+const uint32_t LED_MAX_DEFER = 100;    // [ms] Longest wait for a quiet time
+
+uint32_t led_shown = 0;     // Color on the LED
+uint32_t led_wanted = 0;    // Color to go onto the LED
+uint32_t led_wanted_millis; // When `led_wanted` last changed
+
+void led_show(uint32_t color) {
+  // Write the LED right away
+  led_rgb.setPixelColor(0, color);
+  led_rgb.show();
+  led_shown = color;
+}
+
+bool led_gap_ahead(uint32_t now) {
+  /* Is now a good time to write the LED, i.e. will it not delay acquiring
+  the next sample?
+  */
+  if ((scope_state == SCOPE_ARMED) || (scope_state == SCOPE_TRIGGERED)) {
+    return false;
+  }
+  if (!DAQ_running) {
+    return true;
+  }
+  if (sweep_state != SWEEP_IDLE) {
+    return false;
+  }
+  if ((acq_mode == ACQ_TRIGGERED) && !trig_pending) {
+    return true; // Only delays the next burst of triggers
+  }
+  if (now - led_wanted_millis >= LED_MAX_DEFER) {
+    return true;
+  }
+  if (((stamp_mode == STAMP_SENSOR) || sched_on) && (latch_pending != 0) &&
+      (ina228_bank.fresh_mask() != 0)) {
+    return false; // Sensors latch at their own phase, no gap to be found
+  }
+
+  uint64_t due_us = ((acq_mode == ACQ_TRIGGERED) ? trig_stamp_us
+                                                 : sweep_stamp_us) +
+                    conversion_period_us();
+  return timestamp_us() + LED_GAP_US < due_us;
+}
+
+void led_update(uint32_t now) {
+  // Signal the state and any recent problem, deferring the write when needed
+  static uint32_t prev_i2c_errors = 0;
+  static uint32_t prev_dropped = 0;
+  static uint32_t i2c_error_millis = 0;
+  static uint32_t overflow_millis = 0;
+  static uint32_t host_lag_millis = 0;
+  static bool any_fault = false;
+
+  uint32_t dropped = sample_ring.dropped() + summary_dropped;
+  if (i2c_errors != prev_i2c_errors) {
+    prev_i2c_errors = i2c_errors;
+    i2c_error_millis = now;
+    any_fault = true;
+  }
+  if (dropped != prev_dropped) {
+    // Also on a reset of the counters by `stats`, which is harmless
+    prev_dropped = dropped;
+    overflow_millis = now;
+    any_fault = true;
+  }
+  if (sample_ring.size() > sample_ring.capacity() / 2) {
+    host_lag_millis = now;
+    any_fault = true;
+  }
+
+  uint32_t color = (scope_state != SCOPE_IDLE) ? LED_COLOR_SCOPE
+                   : DAQ_running               ? LED_COLOR_DAQ_RUNNING
+                   : idle_active               ? LED_COLOR_LOW_POWER
+                                               : LED_COLOR_IDLE;
+  if (any_fault && ((now / LED_BLINK_PERIOD) & 1)) {
+    if (now - i2c_error_millis < LED_FAULT_HOLD) {
+      color = LED_COLOR_I2C_ERROR;
+    } else if (now - overflow_millis < LED_FAULT_HOLD) {
+      color = LED_COLOR_OVERFLOW;
+    } else if (now - host_lag_millis < LED_FAULT_HOLD) {
+      color = LED_COLOR_HOST_LAG;
+    } else {
+      any_fault = false;
+    }
+  }
+
+  if (color != led_wanted) {
+    led_wanted = color;
+    led_wanted_millis = now;
+  }
+  if ((led_wanted != led_shown) && led_gap_ahead(now)) {
+    led_show(led_wanted);
+  }
+}
+#endif
+
+/*------------------------------------------------------------------------------
+  Serial commands
+
+  Looked up by `sc.dispatch()` in the table below by their first token, the
+  remaining tokens get passed on as arguments. Unknown commands get an error
+  reply.
+------------------------------------------------------------------------------*/
+
+void cmd_id(uint8_t argc, char **argv) {
+  // `id? <transport>` negotiates the transport, see `Transport`
+  Transport wanted = TRANSPORT_CDC;
+  if (argc == 2) {
+    parse_transport(argv[1], &wanted); // Unknown ones get `cdc`
+  }
+  set_transport(wanted);
+  if (argc == 2) {
+    snprintf(buf, BUFLEN, "Arduino, Wind Farm\t%s",
+             TRANSPORT_NAMES[transport]);
+    Ser.println(buf);
+  } else {
+    Ser.println("Arduino, Wind Farm");
+  }
+  DAQ_running = false;
+}
+
+void cmd_reset_accumulators(uint8_t argc, char **argv) {
+  reset_energy();
+  for (auto &sent : energy_sent) {
+    sent = 0;
+  }
+}
+
+void cmd_energy(uint8_t argc, char **argv) { report_energy(); }
+
+void cmd_on(uint8_t argc, char **argv) {
+  abort_scope();
+  wake_on_us = timestamp_us();
+  wake_pending = true;
+  wake_restore_us = 0;
+  wake_from_idle();
+  DAQ_running = true;
+  sample_seq = 0;
+  sample_ring.clear();
+  sample_ring.reset_counters();
+  summary_seq = 0;
+  summary_dropped = 0;
+  summary_pending = false;
+  reset_summary();
+  trig_pending = false;
+  trig_skew_max = 0;
+  latch_pending = 0;
+  if (sched_on) {
+    reset_sched();
+    apply_sched_due();
+  }
+  bench_next_us = timestamp_us();
+  tx_batch.reset_counters();
+  link_on_us = timestamp_us();
+  link_off_us = 0;
+  if (stream_mode == STREAM_TEXT) {
+    send_header();
+  }
+}
+
+void cmd_off(uint8_t argc, char **argv) {
+  DAQ_running = false;
+  sample_ring.clear();
+  tx_batch.flush(Ser); // The frames that were complete already
+  link_off_us = timestamp_us();
+}
+
+void cmd_dec(uint8_t argc, char **argv) {
+  if (!parse_dec(argc, argv)) {
+    Ser.println("ERROR: dec n=<#> | dec t=<ms> | dec");
+  }
+}
+
+void cmd_ring(uint8_t argc, char **argv) {
+  // Report ring buffer usage: fill, high-water mark, capacity, dropped, and
+  // dropped summary windows
+  snprintf(buf, BUFLEN, "%lu\t%lu\t%lu\t%lu\t%lu", sample_ring.size(),
+           sample_ring.max_fill(), sample_ring.capacity(),
+           sample_ring.dropped(), summary_dropped);
+  Ser.println(buf);
+}
+
+void cmd_trig(uint8_t argc, char **argv) { set_acq_mode(ACQ_TRIGGERED); }
+
+void cmd_cont(uint8_t argc, char **argv) { set_acq_mode(ACQ_CONTINUOUS); }
+
+void cmd_ts(uint8_t argc, char **argv) {
+  if ((argc == 2) && (strcmp(argv[1], "row") == 0)) {
+    set_stamp_mode(STAMP_ROW);
+  } else if ((argc == 2) && (strcmp(argv[1], "sensor") == 0)) {
+    set_stamp_mode(STAMP_SENSOR);
+  } else {
+    Ser.println("ERROR: ts row | ts sensor");
+  }
+}
+
+void cmd_skew(uint8_t argc, char **argv) { report_skew(); }
+
+void cmd_stats_report(uint8_t argc, char **argv) { report_stage_stats(); }
+
+void cmd_stats(uint8_t argc, char **argv) {
+  if ((argc == 2) && (strcmp(argv[1], "r") == 0)) {
+    reset_stage_stats();
+  } else {
+    Ser.println("ERROR: stats? | stats r");
+  }
+}
+
+void cmd_bin(uint8_t argc, char **argv) { stream_mode = STREAM_BINARY; }
+
+void cmd_txt(uint8_t argc, char **argv) { stream_mode = STREAM_TEXT; }
+
+void cmd_scope(uint8_t argc, char **argv) {
+  // Any capture in progress ends here, also when rearming
+  abort_scope();
+  if ((argc == 2) && (strcmp(argv[1], "off") == 0)) {
+    return;
+  }
+  if (!parse_scope(argc, argv)) {
+    Ser.println("ERROR: scope ch=<I|V> trig=<rise|fall|step> thr=<value> "
+                "pre=<#> s=<sensor> | scope off");
+    return;
+  }
+  if (!ina228_bank.up(scope_sensor)) {
+    Ser.println("ERROR: Sensor is down");
+    return;
+  }
+  DAQ_running = false;
+  wake_from_idle();
+  arm_scope();
+}
+
+void cmd_scope_report(uint8_t argc, char **argv) { report_scope(); }
+
+void cmd_ch(uint8_t argc, char **argv) {
+  uint8_t channels;
+  if ((argc != 2) || !parse_channels(argv[1], &channels) ||
+      !ina228_bank.set_channels(channels)) {
+    Ser.println("ERROR: ch <I,V,E,P,T,Q>");
+    return;
+  }
+
+  // Samples in the pipeline no longer match the new layout
+  sample_ring.clear();
+  summary_pending = false;
+  reset_summary();
+  latch_pending = 0;
+  if (DAQ_running && (stream_mode == STREAM_TEXT)) {
+    send_header();
+  }
+}
+
+void cmd_ch_report(uint8_t argc, char **argv) { report_channels(); }
+
+void cmd_snap(uint8_t argc, char **argv) {
+  if ((argc == 2) && (strcmp(argv[1], "on") == 0)) {
+    ina228_bank.set_snapshot(true);
+  } else if ((argc == 2) && (strcmp(argv[1], "off") == 0)) {
+    ina228_bank.set_snapshot(false);
+  } else {
+    Ser.println("ERROR: snap on | snap off");
+  }
+}
+
+void cmd_snap_report(uint8_t argc, char **argv) { report_snapshot(); }
+
+void cmd_cfg(uint8_t argc, char **argv) {
+  if (!parse_cfg(argc, argv)) {
+    Ser.println("ERROR: cfg ct=<us> vt=<us> tt=<us> avg=<#>");
+  }
+  report_cfg();
+}
+
+void cmd_health(uint8_t argc, char **argv) { report_health(); }
+
+void cmd_cal(uint8_t argc, char **argv) {
+  if (!parse_cal(argc, argv)) {
+    Ser.println("ERROR: cal s=<sensor> r=<Ohm> gain=<factor> range=<0|1>");
+  }
+  report_cal();
+}
+
+void cmd_cal_report(uint8_t argc, char **argv) { report_cal(); }
+
+void cmd_bench(uint8_t argc, char **argv) {
+  if (!parse_bench(argc, argv)) {
+    Ser.println("ERROR: bench <Hz> | bench off");
+  }
+}
+
+void cmd_bench_report(uint8_t argc, char **argv) { report_bench(); }
+
+void cmd_time(uint8_t argc, char **argv) {
+  buf[0] = '\0';
+  append_timestamp(timestamp_us());
+  Ser.println(buf);
+}
+
+void cmd_sync(uint8_t argc, char **argv) {
+  if (!parse_sync(argc, argv)) {
+    Ser.println("ERROR: sync <local_us> <host_us> | sync r");
+  }
+}
+
+void cmd_sync_report(uint8_t argc, char **argv) { report_sync(); }
+
+void cmd_sched(uint8_t argc, char **argv) {
+  bool was_on = sched_on;
+  if (!parse_sched(argc, argv)) {
+    Ser.println("ERROR: sched on|off thr=<mA>, needs cont");
+    return;
+  }
+
+  // Text rows gain or lose the column `slow`
+  if ((sched_on != was_on) && DAQ_running && (stream_mode == STREAM_TEXT)) {
+    sample_ring.clear();
+    send_header();
+  }
+}
+
+void cmd_sched_report(uint8_t argc, char **argv) { report_sched(); }
+
+void cmd_link(uint8_t argc, char **argv) { report_link(); }
+
+void cmd_idle(uint8_t argc, char **argv) {
+  if ((argc == 2) && (strcmp(argv[1], "on") == 0)) {
+    idle_on = true;
+  } else if ((argc == 2) && (strcmp(argv[1], "off") == 0)) {
+    idle_on = false;
+    wake_from_idle();
+  } else {
+    Ser.println("ERROR: idle on | idle off");
+  }
+}
+
+void cmd_idle_report(uint8_t argc, char **argv) { report_idle(); }
+
+void cmd_save(uint8_t argc, char **argv) {
+  if ((argc > 1) && (strcmp(argv[1], "clear") == 0)) {
+    config_store.erase();
+    Ser.println("Cleared");
+  } else if (save_config()) {
+    Ser.println("Saved");
+  } else {
+    Ser.println("ERROR: Saving to flash failed");
+  }
+}
+
+const DvG_Command COMMANDS[] = {
+    {"id?", cmd_id},
+    {"r", cmd_reset_accumulators},
+    {"E?", cmd_energy},
+    {"on", cmd_on},
+    {"off", cmd_off},
+    {"dec", cmd_dec},
+    {"ring?", cmd_ring},
+    {"trig", cmd_trig},
+    {"cont", cmd_cont},
+    {"ts", cmd_ts},
+    {"skew?", cmd_skew},
+    {"stats?", cmd_stats_report},
+    {"stats", cmd_stats},
+    {"bin", cmd_bin},
+    {"txt", cmd_txt},
+    {"scope", cmd_scope},
+    {"scope?", cmd_scope_report},
+    {"ch", cmd_ch},
+    {"ch?", cmd_ch_report},
+    {"snap", cmd_snap},
+    {"snap?", cmd_snap_report},
+    {"cfg", cmd_cfg},
+    {"cal", cmd_cal},
+    {"cal?", cmd_cal_report},
+    {"save", cmd_save},
+    {"health?", cmd_health},
+    {"bench", cmd_bench},
+    {"bench?", cmd_bench_report},
+    {"t?", cmd_time},
+    {"sync", cmd_sync},
+    {"sync?", cmd_sync_report},
+    {"sched", cmd_sched},
+    {"sched?", cmd_sched_report},
+    {"link?", cmd_link},
+    {"idle", cmd_idle},
+    {"idle?", cmd_idle_report},
+};
+
+/*------------------------------------------------------------------------------
+    setup
+------------------------------------------------------------------------------*/
+
+void setup() {
+  asm(".global _printf_float"); // Enables float support for `snprintf()`
+  latency_stats_begin();
+
+// Starting setup
+#if HAS_NEOPIXEL || HAS_DOTSTAR
+  led_rgb.begin();
+  led_rgb.setBrightness(255);
+  led_show(LED_COLOR_SETUP);
+#endif
+
+  Ser.begin(115200); // Has no effect on native USB, see `Transport`
+  while (!Ser) { // Wait until serial port is opened
+    delay(10);
+  }
+  sc.setCommands(COMMANDS, sizeof(COMMANDS) / sizeof(COMMANDS[0]));
+  load_config();
+
+  // With `SKIP_RESET` the registers that already hold the configuration of a
+  // previous run do not get written again. A sensor that does not respond
+  // starts out down and gets probed again from `loop()`, see `health?`.
+  for (uint8_t i = 0; i < N_sensors; i++) {
+    if (!begin_sensor(i)) {
+      ina228_bank.set_up(i, false);
+    }
+
+    // Report settings to terminal
+    /*
+    Adafruit_INA228 &ina228 = ina228_bank.sensors[i];
+    Ser.print("ADC range      : ");
+    Ser.println(ina228.getADCRange());
+    Ser.print("Mode           : ");
+    Ser.println(ina228.getMode());
+    Ser.print("Averaging count: ");
+    Ser.println(ina228.getAveragingCount());
+    Ser.print("Current     conversion time: ");
+    Ser.println(ina228.getCurrentConversionTime());
+    Ser.print("Voltage     conversion time: ");
+    Ser.println(ina228.getVoltageConversionTime());
+    Ser.print("Temperature conversion time: ");
+    Ser.println(ina228.getTemperatureConversionTime());
+    Ser.println();
+    */
+  }
+
+  // Only now, because `Wire.begin()` as called by `ina228.begin()` resets it
+  for (uint8_t b = 0; b < SENSOR_BANK_MAX_BUSES; b++) {
+    ina228_bank.set_speed(b, I2C_CLOCK[b]);
+  }
+
+  ina228_bank.set_snapshot(true); // Also describes the sweep
+
+  if (PIN_ALERT >= 0) {
+    pinMode(PIN_ALERT, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(PIN_ALERT), isr_alert, FALLING);
+    ina228_bank.sensors[0].alertFunctionFlags(); // Release a pending alert
+  }
+
+// Finished setup and idle
+#if HAS_NEOPIXEL || HAS_DOTSTAR
+  led_show(LED_COLOR_IDLE);
+  led_wanted = LED_COLOR_IDLE;
+#endif
+}
+
+/*------------------------------------------------------------------------------
+    loop
+------------------------------------------------------------------------------*/
+
+void loop() {
+  // float V_shunt; // [mV] Shunt voltage
+  // float P;       // [mW] Power
+  // float T_die;   // ['C] Die temperature
+
+  // Time keeping
+  uint32_t millis_copy = millis();
+  uint64_t stamp_us;
+  uint32_t t0;
+  extend_timestamp(millis_copy, 0); // Track millis rollovers, even when idle
+
+  static uint32_t loop_cycles = cycles_now();
+  t0 = cycles_now();
+  stage_stats[STAGE_LOOP].add(t0 - loop_cycles);
+  loop_cycles = t0;
+
+  /*----------------------------------------------------------------------------
+    Process incoming serial commands every PERIOD_SC milliseconds
+  ----------------------------------------------------------------------------*/
+  static uint32_t tick_sc = millis_copy;
+
+  // Commands may access the I2C bus, so wait for a background sweep to finish
+  if ((sweep_state != SWEEP_BUSY) && ((millis_copy - tick_sc) > PERIOD_SC)) {
+    tick_sc = millis_copy;
+    t0 = cycles_now();
+    tx_batch.flush(Ser); // Ahead of any reply
+    sc.dispatch();
+    stage_stats[STAGE_COMMANDS].add_since(t0);
+  }
+  tx_service();
+  service_idle(millis_copy);
+
+  /*----------------------------------------------------------------------------
+    LED indicator
+  ----------------------------------------------------------------------------*/
+
+#if HAS_NEOPIXEL || HAS_DOTSTAR
+  led_update(millis_copy);
+#endif
+
+  /*----------------------------------------------------------------------------
+    Scope mode, takes over from the regular acquisition while active
+  ----------------------------------------------------------------------------*/
+
+  if (scope_state != SCOPE_IDLE) {
+    run_scope();
+    return;
+  }
+
+  /*----------------------------------------------------------------------------
+    Acquire data
+  ----------------------------------------------------------------------------*/
+
+  for (auto &engine : i2c_async) {
+    engine.poll();
+  }
+
+  // Sensors that went down or are due for a probe. Only when the bus is free
+  // and not halfway a burst of triggers, which a sensor rejoining would miss.
+  if ((sweep_state == SWEEP_IDLE) && !trig_pending) {
+    service_health(millis_copy);
+  }
+
+  // Only check for new data when the bus is free. The first sensor that is
+  // up paces the sweeps.
+  uint32_t up = ina228_bank.up_mask();
+  if ((sweep_state == SWEEP_IDLE) && bench_on) {
+    if (DAQ_running) {
+      run_bench();
+    }
+  } else if ((sweep_state == SWEEP_IDLE) && up) {
+    if (acq_mode == ACQ_TRIGGERED) {
+      // The last sensor got triggered last, so it is the last to finish
+      if (DAQ_running) {
+        if (!trig_pending) {
+          trigger_all();
+        } else if (stamp_mode == STAMP_SENSOR) {
+          if (collect_latches()) {
+            trig_pending = false;
+            latches_to_sweep();
+          }
+        } else if (poll_conversion_ready(
+                       ina228_bank.sensors[last_sensor(up)])) {
+          trig_pending = false;
+          int32_t latch_offsets_us[N_sensors]; // Within the trigger skew
+          for (size_t i = 0; i < N_sensors; i++) {
+            latch_offsets_us[i] = (int32_t)trig_offsets[i];
+          }
+          start_sweep(trig_stamp_us + conversion_period_us(),
+                      latch_offsets_us);
+        }
+      }
+    } else if (sched_on) {
+      // Idle sensors get polled from 7/8 of their conversion period on
+      uint32_t slow_period_us = slow_conversion_period_us();
+      if (DAQ_running &&
+          collect_latches(sched_slow, slow_period_us - slow_period_us / 8)) {
+        latches_to_sweep();
+      }
+    } else if (stamp_mode == STAMP_SENSOR) {
+      if (DAQ_running && collect_latches()) {
+        latches_to_sweep();
+      }
+    } else if (PIN_ALERT >= 0) {
+      if (alert_fired) {
+        noInterrupts();
+        stamp_us = alert_stamp_us;
+        alert_fired = false;
+        interrupts();
+
+        // Reading DIAG_ALRT clears the latched alert and re-arms the ALERT pin
+        ina228_bank.sensors[0].alertFunctionFlags();
+        if (DAQ_running) {
+          start_sweep(stamp_us);
+        }
+      }
+    } else if (DAQ_running &&
+               poll_conversion_ready(ina228_bank.sensors[first_sensor(up)])) {
+      start_sweep(timestamp_us());
+    }
+  }
+
+  if (sweep_state == SWEEP_DONE) {
+    t0 = cycles_now();
+    finish_sweep();
+    stage_stats[STAGE_STORE].add_since(t0);
+    note_first_sample();
+  }
+
+  // Sensors that the adaptive scheduler moved to the other profile
+  if ((sweep_state == SWEEP_IDLE) && sched_due) {
+    apply_sched_due();
+  }
+
+  // Keep the energy totals going when the sweeps do not take care of it,
+  // unless the sensors are shut down by `Low-power idle`
+  if ((sweep_state == SWEEP_IDLE) && !idle_active &&
+      (millis_copy - energy_fold_millis >= ENERGY_FOLD_PERIOD)) {
+    fold_energy();
+  }
+
+  /*----------------------------------------------------------------------------
+    Send out data, one record per pass so that acquisition keeps going while
+    the host is slow to accept
+  ----------------------------------------------------------------------------*/
+
+  if (!DAQ_running) {
+    idle_sleep();
+    return;
+  }
+
+  t0 = cycles_now();
+  if (summary_pending) {
+    send_summary(summary_out);
+    summary_pending = false;
+    stage_stats[STAGE_SEND].add_since(t0);
+    return;
+  }
+
+  const SampleRecord *rec = sample_ring.front();
+  if (rec) {
+    send_sample(*rec);
+    sample_ring.pop();
+    stage_stats[STAGE_SEND].add_since(t0);
+  }
+}
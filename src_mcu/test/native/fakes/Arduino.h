@@ -0,0 +1,127 @@
+/*
+Minimal stand-in for the Arduino core, just enough to build the libraries in
+`lib/` and the headers in `src/` on the host for the native tests. Time only
+advances by `delay()` and `delayMicroseconds()`, or by `fake_advance_us()`,
+so that the tests run instantly and deterministically. GPIO calls do nothing.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_Fake_Arduino
+#define H_Fake_Arduino
+
+#include <ctype.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+
+#define HIGH 1
+#define LOW 0
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define DEC 10
+#define HEX 16
+
+enum BitOrder { LSBFIRST = 0, MSBFIRST = 1 };
+
+class __FlashStringHelper;
+#define F(string_literal)                                                      \
+  (reinterpret_cast<const __FlashStringHelper *>(string_literal))
+
+// [us] Fake time since boot
+inline uint64_t fake_time_us = 0;
+inline void fake_advance_us(uint64_t us) { fake_time_us += us; }
+
+inline uint32_t millis() { return (uint32_t)(fake_time_us / 1000); }
+inline uint32_t micros() { return (uint32_t)fake_time_us; }
+inline void delay(uint32_t ms) { fake_time_us += ms * 1000ULL; }
+inline void delayMicroseconds(uint32_t us) { fake_time_us += us; }
+
+inline void pinMode(uint32_t pin, uint32_t mode) {}
+inline void digitalWrite(uint32_t pin, uint32_t value) {}
+inline int digitalRead(uint32_t pin) { return LOW; }
+
+// Output collected into `output`, to be inspected by the tests
+class Print {
+public:
+  std::string output;
+
+  virtual ~Print() {}
+  virtual size_t write(uint8_t c) {
+    output += (char)c;
+    return 1;
+  }
+  virtual size_t write(const uint8_t *buffer, size_t len) {
+    output.append((const char *)buffer, len);
+    return len;
+  }
+
+  size_t print(const char *str) {
+    return write((const uint8_t *)str, strlen(str));
+  }
+  size_t print(const __FlashStringHelper *str) {
+    return print(reinterpret_cast<const char *>(str));
+  }
+  size_t print(char c) { return write((uint8_t)c); }
+  size_t print(long value, int base = 10) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), (base == 16) ? "%lx" : "%ld", value);
+    return print(buf);
+  }
+  size_t print(unsigned long value, int base = 10) {
+    char buf[24];
+    snprintf(buf, sizeof(buf), (base == 16) ? "%lx" : "%lu", value);
+    return print(buf);
+  }
+  size_t print(int value, int base = 10) { return print((long)value, base); }
+  size_t print(unsigned int value, int base = 10) {
+    return print((unsigned long)value, base);
+  }
+  size_t print(double value, int digits = 2) {
+    char buf[32];
+    snprintf(buf, sizeof(buf), "%.*f", digits, value);
+    return print(buf);
+  }
+
+  size_t println() { return print("\r\n"); }
+  template <typename T> size_t println(T value) {
+    return print(value) + println();
+  }
+  template <typename T> size_t println(T value, int format) {
+    return print(value, format) + println();
+  }
+};
+
+// Input scripted with `feed()`, output collected as by `Print`
+class Stream : public Print {
+public:
+  std::string input;
+
+  void feed(const char *str) { input += str; }
+
+  virtual int available() { return (int)input.size(); }
+  virtual int read() {
+    if (input.empty()) {
+      return -1;
+    }
+    int c = (uint8_t)input[0];
+    input.erase(0, 1);
+    return c;
+  }
+  size_t readBytes(char *buffer, size_t len) {
+    size_t n = (len < input.size()) ? len : input.size();
+    memcpy(buffer, input.data(), n);
+    input.erase(0, n);
+    return n;
+  }
+};
+
+// Serial port, scripted and inspected by the tests
+inline Stream Serial;
+
+#endif
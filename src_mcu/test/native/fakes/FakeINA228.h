@@ -0,0 +1,52 @@
+/*
+Scripts an INA228 onto the fake `TwoWire` of `Wire.h`, with the identification
+and configuration registers at their power-on defaults and all result
+registers reading zero, so that `Adafruit_INA228::begin()` succeeds. The
+result registers get set with the helpers below, from the same raw counts as
+found in `INA228_Measurement`.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_FakeINA228
+#define H_FakeINA228
+
+#include <Wire.h>
+
+#include "Adafruit_INA228.h"
+
+inline void fake_ina228(TwoWire &wire, uint8_t address) {
+  wire.add_device(address);
+  wire.set_register(address, INA228_REG_MFG_UID, 0x5449, 2); // "TI"
+  wire.set_register(address, INA228_REG_DVC_UID, 0x2281, 2);
+  wire.set_register(address, INA228_REG_CONFIG, 0x0000, 2);
+  wire.set_self_clearing(address, INA228_REG_CONFIG, 0xC000); // RST, RSTACC
+  wire.set_register(address, INA228_REG_ADCCFG, 0xFB68, 2);
+  wire.set_register(address, INA228_REG_SHUNTCAL, 0x1000, 2);
+  wire.set_register(address, INA228_REG_DIAGALRT, 0x0001, 2);
+  wire.set_register(address, INA228_REG_VBUS, 0, 3);
+  wire.set_register(address, INA228_REG_DIETEMP, 0, 2);
+  wire.set_register(address, INA228_REG_CURRENT, 0, 3);
+  wire.set_register(address, INA228_REG_POWER, 0, 3);
+  wire.set_register(address, INA228_REG_ENERGY, 0, 5);
+  wire.set_register(address, INA228_REG_CHARGE, 0, 5);
+}
+
+// Set the result registers from raw counts, left-aligned where the INA228
+// keeps its 20-bit results in the upper bits of a 24-bit register
+inline void fake_ina228_results(TwoWire &wire, uint8_t address,
+                                int32_t current_raw, uint32_t vbus_raw,
+                                uint64_t energy_raw, uint32_t power_raw = 0,
+                                int16_t die_temp_raw = 0,
+                                int64_t charge_raw = 0) {
+  wire.set_register(address, INA228_REG_CURRENT,
+                    ((uint32_t)current_raw << 4) & 0xFFFFFF, 3);
+  wire.set_register(address, INA228_REG_VBUS, (vbus_raw << 4) & 0xFFFFFF, 3);
+  wire.set_register(address, INA228_REG_ENERGY, energy_raw, 5);
+  wire.set_register(address, INA228_REG_POWER, power_raw, 3);
+  wire.set_register(address, INA228_REG_DIETEMP, (uint16_t)die_temp_raw, 2);
+  wire.set_register(address, INA228_REG_CHARGE,
+                    (uint64_t)charge_raw & 0xFFFFFFFFFFULL, 5);
+}
+
+#endif
@@ -0,0 +1,34 @@
+/*
+Stand-in for the Arduino SPI library, only so that `Adafruit_SPIDevice` of
+the BusIO library builds for the native tests. Transfers do nothing.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_Fake_SPI
+#define H_Fake_SPI
+
+#include <Arduino.h>
+
+#define SPI_MODE0 0
+#define SPI_MODE1 1
+#define SPI_MODE2 2
+#define SPI_MODE3 3
+
+class SPISettings {
+public:
+  SPISettings(uint32_t clock, BitOrder order, uint8_t mode) {}
+};
+
+class SPIClass {
+public:
+  void begin() {}
+  void beginTransaction(SPISettings settings) {}
+  void endTransaction() {}
+  uint8_t transfer(uint8_t data) { return 0xFF; }
+  void transfer(void *buffer, size_t len) { memset(buffer, 0xFF, len); }
+};
+
+inline SPIClass SPI;
+
+#endif
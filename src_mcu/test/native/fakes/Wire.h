@@ -0,0 +1,163 @@
+/*
+Fake `TwoWire` for the native tests: a scripted bus of INA228-like devices
+that counts every transaction. Each device holds its registers by address.
+The first byte written to a device sets its register pointer, any further
+bytes of that write replace the contents of the register. A read returns the
+register at the pointer, which does not auto-increment, as with the INA228.
+Bits marked with `set_self_clearing()` read back as 0 after a write.
+
+  Wire.add_device(0x40);
+  Wire.set_register(0x40, 0x07, 0x0ABCDE, 3); // CURRENT, big-endian
+
+Reads of an absent device, of a register that was never set or of a device
+told to `fail()` get NACKed. The counters split the transactions into writes
+(address + data, ending at `endTransmission()`) and reads (`requestFrom()`),
+and count the bytes each moved across the bus, not counting the address.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#ifndef H_Fake_Wire
+#define H_Fake_Wire
+
+#include <Arduino.h>
+
+#include <map>
+#include <vector>
+
+class TwoWire : public Stream {
+public:
+  struct Device {
+    uint8_t pointer = 0;
+    uint32_t n_failures = 0; // Transactions left to NACK
+    // Bits per register that clear right after being written, like RST
+    std::map<uint8_t, uint64_t> self_clearing;
+    std::map<uint8_t, std::vector<uint8_t>> registers;
+  };
+
+  std::map<uint8_t, Device> devices;
+
+  // Transaction counters, see above
+  uint32_t n_writes = 0;
+  uint32_t n_reads = 0;
+  uint32_t n_bytes_written = 0;
+  uint32_t n_bytes_read = 0;
+  uint32_t clock = 100000; // [Hz] As set by `setClock()`
+
+  void reset_counters() {
+    n_writes = 0;
+    n_reads = 0;
+    n_bytes_written = 0;
+    n_bytes_read = 0;
+  }
+  uint32_t n_transactions() const { return n_writes + n_reads; }
+
+  void add_device(uint8_t address) { devices[address]; }
+  void remove_device(uint8_t address) { devices.erase(address); }
+
+  // NACK the next `n` transactions addressed to the device
+  void fail(uint8_t address, uint32_t n) { devices[address].n_failures = n; }
+
+  // Store the lowest `len` bytes of `value` big-endian, as the INA228 does
+  void set_register(uint8_t address, uint8_t reg, uint64_t value,
+                    uint8_t len) {
+    std::vector<uint8_t> &bytes = devices[address].registers[reg];
+    bytes.resize(len);
+    for (uint8_t i = 0; i < len; i++) {
+      bytes[len - 1 - i] = (uint8_t)(value >> (8 * i));
+    }
+  }
+
+  // Let the bits `mask` of a register clear right after being written
+  void set_self_clearing(uint8_t address, uint8_t reg, uint64_t mask) {
+    devices[address].self_clearing[reg] = mask;
+  }
+
+  // Contents of a register as a big-endian number, 0 when never set
+  uint64_t get_register(uint8_t address, uint8_t reg) {
+    uint64_t value = 0;
+    for (uint8_t byte : devices[address].registers[reg]) {
+      value = (value << 8) | byte;
+    }
+    return value;
+  }
+
+  void begin() {}
+  void end() {}
+  void setClock(uint32_t freq) { clock = freq; }
+
+  void beginTransmission(uint8_t address) {
+    _address = address;
+    _tx.clear();
+  }
+
+  size_t write(uint8_t data) override {
+    _tx.push_back(data);
+    return 1;
+  }
+  size_t write(const uint8_t *data, size_t len) override {
+    _tx.insert(_tx.end(), data, data + len);
+    return len;
+  }
+
+  uint8_t endTransmission(bool stop = true) {
+    n_writes++;
+    Device *dev = find(_address);
+    if (!dev) {
+      return 2; // NACK on address
+    }
+    n_bytes_written += _tx.size();
+    if (!_tx.empty()) {
+      dev->pointer = _tx[0];
+      if (_tx.size() > 1) {
+        std::vector<uint8_t> &bytes = dev->registers[_tx[0]];
+        bytes.assign(_tx.begin() + 1, _tx.end());
+        uint64_t mask = dev->self_clearing[_tx[0]];
+        for (size_t i = 0; i < bytes.size(); i++) {
+          bytes[bytes.size() - 1 - i] &= ~(uint8_t)(mask >> (8 * i));
+        }
+      }
+    }
+    return 0;
+  }
+
+  uint8_t requestFrom(uint8_t address, uint8_t len, uint8_t stop = true) {
+    n_reads++;
+    _rx.clear();
+    _rx_pos = 0;
+    Device *dev = find(address);
+    if (!dev || !dev->registers.count(dev->pointer)) {
+      return 0;
+    }
+    _rx = dev->registers[dev->pointer];
+    _rx.resize(len, 0); // Beyond the register the bus reads as zeros
+    n_bytes_read += len;
+    return len;
+  }
+
+  int available() override { return (int)(_rx.size() - _rx_pos); }
+  int read() override { return (_rx_pos < _rx.size()) ? _rx[_rx_pos++] : -1; }
+
+private:
+  uint8_t _address = 0;
+  std::vector<uint8_t> _tx;
+  std::vector<uint8_t> _rx;
+  size_t _rx_pos = 0;
+
+  Device *find(uint8_t address) {
+    auto it = devices.find(address);
+    if (it == devices.end()) {
+      return nullptr;
+    }
+    if (it->second.n_failures > 0) {
+      it->second.n_failures--;
+      return nullptr;
+    }
+    return &it->second;
+  }
+};
+
+inline TwoWire Wire;
+inline TwoWire Wire1;
+
+#endif
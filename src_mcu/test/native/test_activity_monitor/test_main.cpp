@@ -0,0 +1,89 @@
+/*
+Native tests of `ActivityMonitor.h`: judging the activity of a current from
+its RMS deviation over windows, with the hold-off before turning idle.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#include <unity.h>
+
+#include "ActivityMonitor.h"
+
+const float THRESHOLD = 0.5; // [mA]
+const uint8_t HOLD = 3;
+
+ActivityMonitor monitor;
+
+bool window(float mean, float ripple, uint32_t n = 20) {
+  // Feed a window of `n` samples alternating around `mean` [mA] by `ripple`
+  for (uint32_t i = 0; i < n; i++) {
+    monitor.add(mean + ((i & 1) ? ripple : -ripple));
+  }
+  return monitor.close_window(THRESHOLD, HOLD);
+}
+
+void setUp() { monitor.reset(); }
+
+void tearDown() {}
+
+void test_starts_active() {
+  TEST_ASSERT_TRUE(monitor.active);
+  TEST_ASSERT_TRUE(isnan(monitor.activity));
+}
+
+void test_turns_idle_after_hold() {
+  // A large steady current is no activity
+  TEST_ASSERT_FALSE(window(150, 0.01));
+  TEST_ASSERT_FALSE(window(150, 0.01));
+  TEST_ASSERT_TRUE(monitor.active);
+  TEST_ASSERT_TRUE(window(150, 0.01));
+  TEST_ASSERT_FALSE(monitor.active);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 0.01, monitor.activity);
+}
+
+void test_ripple_is_activity() {
+  for (uint8_t i = 0; i < HOLD; i++) {
+    window(150, 0.01);
+  }
+  TEST_ASSERT_FALSE(monitor.active);
+  TEST_ASSERT_TRUE(window(150, 2));
+  TEST_ASSERT_TRUE(monitor.active);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 2, monitor.activity);
+}
+
+void test_step_is_activity() {
+  // A step in between steady windows shows up as deviation from the mean of
+  // the previous window
+  for (uint8_t i = 0; i < HOLD; i++) {
+    window(150, 0.01);
+  }
+  TEST_ASSERT_TRUE(window(151, 0.01));
+  TEST_ASSERT_FLOAT_WITHIN(1e-2, 1, monitor.activity);
+
+  // Settled again, so the hold-off starts over
+  TEST_ASSERT_FALSE(window(151, 0.01));
+  TEST_ASSERT_FALSE(window(151, 0.01));
+  TEST_ASSERT_TRUE(window(151, 0.01));
+}
+
+void test_short_window_carries_on() {
+  monitor.add(10);
+  TEST_ASSERT_FALSE(monitor.close_window(THRESHOLD, HOLD));
+  TEST_ASSERT_EQUAL_UINT32(1, monitor.dev.count);
+  monitor.add(NAN); // Ignored
+  TEST_ASSERT_EQUAL_UINT32(1, monitor.dev.count);
+  monitor.add(10);
+  monitor.close_window(THRESHOLD, HOLD);
+  TEST_ASSERT_EQUAL_UINT32(0, monitor.dev.count);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0, monitor.activity);
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_starts_active);
+  RUN_TEST(test_turns_idle_after_hold);
+  RUN_TEST(test_ripple_is_activity);
+  RUN_TEST(test_step_is_activity);
+  RUN_TEST(test_short_window_carries_on);
+  return UNITY_END();
+}
@@ -0,0 +1,193 @@
+/*
+Native microbenchmarks of the path from the INA228 registers to a binary
+frame, for the sensor table of `main.cpp`: reading out a sweep over the fake
+I2C bus, decoding and scaling the results and packing them into a frame.
+
+The costs that do not depend on the host get locked in as exact numbers: I2C
+transactions, bytes and bit times on the bus per sample, and bytes per frame.
+A change to any of these shows up as a failing test, to be updated together
+with the change when intended. The timings in [ns] per sample only get
+printed, next to generous ceilings that merely catch gross regressions, as
+they depend on the host. Compare them against a run before the change.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#include <unity.h>
+
+#include <chrono>
+
+#include "FakeINA228.h"
+#include "SampleFrame.h"
+#include "SensorTable.h"
+
+typedef INA228Bank Bank;
+const size_t N = Bank::N;
+const uint32_t N_ITERATIONS = 20000;
+
+Bank bank;
+uint8_t frame[BIN_HEADER_LEN + N * (Bank::PACKED_LEN + 4) + 2];
+uint32_t energy_deltas[N];
+int32_t latch_offsets_us[N]; // All latched at the timestamp
+
+void setUp() {
+  Wire = TwoWire();
+  bank = Bank();
+  for (size_t i = 0; i < N; i++) {
+    fake_ina228(Wire, Bank::address(i));
+    fake_ina228_results(Wire, Bank::address(i), -1000 * (i + 1), 5120,
+                        1ULL << 33, 640, 3200);
+    TEST_ASSERT_TRUE(bank.sensors[i].begin(Bank::address(i), &Wire, true));
+    bank.sensors[i].setCalibration(0.015, 0.2, 1);
+  }
+  bank.prepare_jobs();
+  Wire.reset_counters();
+}
+
+void tearDown() {}
+
+// [bits] Bus time of the transactions so far, counted as in `max_i2c_rate()`
+// of `main.cpp`: 9 bits per byte including the address bytes, plus 3 bits of
+// START, repeated START and STOP per register read
+uint32_t bus_bits() {
+  return 9 * (Wire.n_writes + Wire.n_bytes_written + Wire.n_reads +
+              Wire.n_bytes_read) +
+         3 * Wire.n_reads;
+}
+
+size_t pack_frame(uint32_t seq) {
+  // As `send_sample()` in binary mode, see `main.cpp`
+  for (size_t i = 0; i < N; i++) {
+    energy_deltas[i] = bank.meas[i].energy_raw & 0xFFFFFF;
+  }
+  return pack_sample_frame(frame, seq, 1000ULL * seq, bank.channels(), 0, N,
+                           bank.meas, energy_deltas, latch_offsets_us);
+}
+
+template <typename F> double time_ns(F body) {
+  // [ns] Mean duration of `body` over `N_ITERATIONS` calls
+  auto t0 = std::chrono::steady_clock::now();
+  for (uint32_t i = 0; i < N_ITERATIONS; i++) {
+    body(i);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(t1 - t0).count() /
+         N_ITERATIONS;
+}
+
+void report(const char *name, double ns) {
+  char msg[80];
+  snprintf(msg, sizeof(msg), "%-24s %10.1f ns/sample", name, ns);
+  TEST_MESSAGE(msg);
+}
+
+/*------------------------------------------------------------------------------
+  Locked-in costs per sample
+------------------------------------------------------------------------------*/
+
+void test_cost_default_channels() {
+  // Current, bus voltage and energy of 6 sensors: 36 transactions and 1134
+  // bit times, so 11.3 ms per sweep at 100 kHz and 1.1 ms at 1 MHz
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32(36, Wire.n_transactions());
+  TEST_ASSERT_EQUAL_UINT32(18, Wire.n_bytes_written);
+  TEST_ASSERT_EQUAL_UINT32(66, Wire.n_bytes_read);
+  TEST_ASSERT_EQUAL_UINT32(1134, bus_bits());
+  TEST_ASSERT_EQUAL_size_t(96, pack_frame(0));
+}
+
+void test_cost_current_only() {
+  TEST_ASSERT_TRUE(bank.set_channels(INA228_CH_CURRENT));
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32(12, Wire.n_transactions());
+  TEST_ASSERT_EQUAL_UINT32(342, bus_bits());
+  TEST_ASSERT_EQUAL_size_t(60, pack_frame(0));
+}
+
+void test_cost_all_channels() {
+  TEST_ASSERT_TRUE(bank.set_channels(INA228_CH_ALL));
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32(72, Wire.n_transactions());
+  TEST_ASSERT_EQUAL_UINT32(126, Wire.n_bytes_read);
+  TEST_ASSERT_EQUAL_UINT32(2214, bus_bits());
+  TEST_ASSERT_EQUAL_size_t(156, pack_frame(0));
+}
+
+void test_cost_snapshot() {
+  // Clearing and checking the conversion-ready flag takes 2 more register
+  // reads per sensor, while the frame stays the same
+  bank.set_snapshot(true);
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32(60, Wire.n_transactions());
+  TEST_ASSERT_EQUAL_UINT32(90, Wire.n_bytes_read);
+  TEST_ASSERT_EQUAL_UINT32(1710, bus_bits());
+  TEST_ASSERT_EQUAL_size_t(96, pack_frame(0));
+}
+
+void test_cost_one_sensor_down() {
+  // Costs nothing on the bus, while its slot in the frame stays
+  bank.set_up(3, false);
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32(30, Wire.n_transactions());
+  TEST_ASSERT_EQUAL_size_t(96, pack_frame(0));
+}
+
+/*------------------------------------------------------------------------------
+  Timings
+------------------------------------------------------------------------------*/
+
+void test_time_read_sweep() {
+  // Blocking sweep through BusIO, including the bookkeeping of the fake bus
+  double ns = time_ns([](uint32_t) { bank.read(); });
+  report("read sweep", ns);
+  TEST_ASSERT_LESS_THAN(200e3, ns);
+}
+
+void test_time_decode() {
+  bank.read();
+  double ns = time_ns([](uint32_t) {
+    for (size_t i = 0; i < N; i++) {
+      bank.sensors[i].decodeMeasurement(bank.meas[i], bank.channels());
+    }
+  });
+  report("decode + scale (float)", ns);
+  TEST_ASSERT_LESS_THAN(10e3, ns);
+}
+
+void test_time_scale_fixed() {
+  // Integer scaling as used by the text rows
+  bank.read();
+  volatile int64_t sink = 0;
+  double ns = time_ns([&sink](uint32_t) {
+    for (size_t i = 0; i < N; i++) {
+      Adafruit_INA228 &ina228 = bank.sensors[i];
+      const INA228_Measurement &meas = bank.meas[i];
+      sink += ina228.currentRawTo_uA(meas.current_raw);
+      sink += ina228.busVoltageRawTo_uV(meas.bus_voltage_raw);
+      sink += ina228.energyRawTo_uJ(meas.energy_raw);
+    }
+  });
+  report("scale (fixed point)", ns);
+  TEST_ASSERT_LESS_THAN(10e3, ns);
+}
+
+void test_time_pack_frame() {
+  bank.read();
+  double ns = time_ns([](uint32_t i) { pack_frame(i); });
+  report("pack frame + CRC", ns);
+  TEST_ASSERT_LESS_THAN(20e3, ns);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_cost_default_channels);
+  RUN_TEST(test_cost_current_only);
+  RUN_TEST(test_cost_all_channels);
+  RUN_TEST(test_cost_snapshot);
+  RUN_TEST(test_cost_one_sensor_down);
+  RUN_TEST(test_time_read_sweep);
+  RUN_TEST(test_time_decode);
+  RUN_TEST(test_time_scale_fixed);
+  RUN_TEST(test_time_pack_frame);
+  return UNITY_END();
+}
@@ -0,0 +1,95 @@
+/*
+Native tests of `ClockSync.h`: the offset and drift fitted through pairs of
+local and host time, and starting over when a clock gets set.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#include <unity.h>
+
+#include "ClockSync.h"
+
+// [us] Host time at boot of the Arduino, some day in 2026
+const uint64_t HOST_AT_BOOT = 1791936000000000ULL;
+
+ClockSync clock_sync;
+
+// [us] Host time at local time `local` for a host clock running `ppb` fast
+uint64_t host_time(uint64_t local, int32_t ppb) {
+  return HOST_AT_BOOT + local + (int64_t)local * ppb / 1000000000;
+}
+
+void setUp() { clock_sync.reset(); }
+
+void tearDown() {}
+
+void test_unsynced() {
+  TEST_ASSERT_FALSE(clock_sync.synced());
+  TEST_ASSERT_EQUAL_UINT64(123456789, clock_sync.to_host(123456789));
+}
+
+void test_single_pair() {
+  clock_sync.add(5000000, HOST_AT_BOOT + 5000000);
+  TEST_ASSERT_TRUE(clock_sync.synced());
+  TEST_ASSERT_EQUAL_INT64(HOST_AT_BOOT, clock_sync.ref_offset_us);
+  TEST_ASSERT_EQUAL_INT32(0, clock_sync.drift_ppb);
+  TEST_ASSERT_EQUAL_UINT64(HOST_AT_BOOT + 6000000, clock_sync.to_host(6000000));
+}
+
+void test_drift() {
+  // Host clock 20 ppm fast, pairs every 5 s with up to 40 us of jitter
+  const int32_t DRIFT = 20000;
+  const int32_t JITTER[] = {0, 40, -25, 10, -40, 30, -5, 20, -15};
+  for (uint8_t i = 0; i < 9; i++) {
+    uint64_t local = 1000000 + i * 5000000ULL;
+    clock_sync.add(local, host_time(local, DRIFT) + JITTER[i]);
+  }
+  TEST_ASSERT_EQUAL(ClockSync::N_POINTS, clock_sync.n_points);
+  TEST_ASSERT_INT32_WITHIN(2000, DRIFT, clock_sync.drift_ppb);
+  TEST_ASSERT_LESS_THAN(60, clock_sync.residual_us);
+
+  // Extrapolated a minute past the latest pair
+  uint64_t local = 101000000;
+  TEST_ASSERT_INT64_WITHIN(150, host_time(local, DRIFT), clock_sync.to_host(local));
+}
+
+void test_no_drift_over_short_span() {
+  // Pairs within `MIN_DRIFT_SPAN_US` only average the offset
+  clock_sync.add(1000000, HOST_AT_BOOT + 1000000 + 100);
+  clock_sync.add(2000000, HOST_AT_BOOT + 2000000 - 100);
+  TEST_ASSERT_EQUAL_INT32(0, clock_sync.drift_ppb);
+  TEST_ASSERT_EQUAL_INT64(HOST_AT_BOOT, clock_sync.ref_offset_us);
+  TEST_ASSERT_EQUAL_UINT32(100, clock_sync.residual_us);
+}
+
+void test_step_starts_over() {
+  for (uint8_t i = 0; i < 4; i++) {
+    uint64_t local = 1000000 + i * 5000000ULL;
+    clock_sync.add(local, host_time(local, 0));
+  }
+  TEST_ASSERT_EQUAL(4, clock_sync.n_points);
+
+  // Host clock set back by a second
+  uint64_t local = 30000000;
+  clock_sync.add(local, host_time(local, 0) - 1000000);
+  TEST_ASSERT_EQUAL(1, clock_sync.n_points);
+  TEST_ASSERT_EQUAL_INT64(HOST_AT_BOOT - 1000000, clock_sync.ref_offset_us);
+}
+
+void test_reset() {
+  clock_sync.add(1000000, HOST_AT_BOOT + 1000000);
+  clock_sync.reset();
+  TEST_ASSERT_FALSE(clock_sync.synced());
+  TEST_ASSERT_EQUAL_UINT64(1000000, clock_sync.to_host(1000000));
+}
+
+int main() {
+  UNITY_BEGIN();
+  RUN_TEST(test_unsynced);
+  RUN_TEST(test_single_pair);
+  RUN_TEST(test_drift);
+  RUN_TEST(test_no_drift_over_short_span);
+  RUN_TEST(test_step_starts_over);
+  RUN_TEST(test_reset);
+  return UNITY_END();
+}
@@ -0,0 +1,99 @@
+/*
+Native tests of `FramePacking.h`: the byte order of the packed fields and the
+CRC-16 as checked by the host with `binascii.crc_hqx(data, 0xFFFF)`. And of
+`SampleFrame.h`: the layout of a sample frame as decoded by the host.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#include <unity.h>
+
+#include "FramePacking.h"
+#include "SampleFrame.h"
+
+void setUp() {}
+
+void tearDown() {}
+
+void test_pack_le() {
+  uint8_t buf[8] = {};
+  uint8_t *end = pack_le(buf, 0x5AA5, 2);
+  TEST_ASSERT_EQUAL(2, end - buf);
+  const uint8_t sync[] = {0xA5, 0x5A};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(sync, buf, 2);
+
+  // Negative CURRENT counts as 24-bit two's complement
+  end = pack_le(buf, (uint32_t)-2, 3);
+  TEST_ASSERT_EQUAL(3, end - buf);
+  const uint8_t current[] = {0xFE, 0xFF, 0xFF};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(current, buf, 3);
+
+  end = pack_le(buf, 0x0102030405060708ULL, 8);
+  const uint8_t stamp[] = {8, 7, 6, 5, 4, 3, 2, 1};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(stamp, buf, 8);
+}
+
+void test_pack_float() {
+  uint8_t buf[4];
+  TEST_ASSERT_EQUAL(4, pack_float(buf, 1.0f) - buf);
+  const uint8_t one[] = {0x00, 0x00, 0x80, 0x3F};
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(one, buf, 4);
+}
+
+void test_crc16_ccitt() {
+  // Check value of CRC-16/CCITT-FALSE
+  const char *check = "123456789";
+  TEST_ASSERT_EQUAL_HEX16(0x29B1,
+                          crc16_ccitt((const uint8_t *)check, strlen(check)));
+  TEST_ASSERT_EQUAL_HEX16(0xFFFF, crc16_ccitt(nullptr, 0));
+}
+
+void test_pack_sample_frame() {
+  INA228_Measurement meas[2] = {};
+  meas[0].current_raw = -2;
+  meas[0].bus_voltage_raw = 0x012345;
+  meas[1].die_temp_raw = -1;
+  meas[1].charge_raw = -3;
+  const uint32_t energy_deltas[2] = {0x0A0B0C, 7};
+  const int32_t latch_offsets_us[2] = {0, INT32_MIN};
+
+  uint8_t frame[64];
+  size_t len = pack_sample_frame(frame, 0x01020304, 0x1122334455667788ULL,
+                                 INA228_CH_DEFAULT, 0x02, 1, meas,
+                                 energy_deltas, latch_offsets_us);
+  const uint8_t expected[] = {
+      0xA5, 0x5A,                                     // Sync word
+      0x04, 0x03, 0x02, 0x01,                         // Sequence counter
+      0x88, 0x77, 0x66, 0x55, 0x44, 0x33, 0x22, 0x11, // Timestamp
+      INA228_CH_DEFAULT, 0x02,                        // Channels, slow
+      0xFE, 0xFF, 0xFF,                               // Current
+      0x45, 0x23, 0x01,                               // Bus voltage
+      0x0C, 0x0B, 0x0A,                               // Energy increment
+      0x00, 0x00, 0x00, 0x00,                         // Latch offset
+  };
+  TEST_ASSERT_EQUAL(sizeof(expected) + 2, len);
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, frame, sizeof(expected));
+  uint16_t crc = crc16_ccitt(frame + 2, len - 4);
+  TEST_ASSERT_EQUAL_HEX8(crc & 0xFF, frame[len - 2]);
+  TEST_ASSERT_EQUAL_HEX8(crc >> 8, frame[len - 1]);
+
+  // Only the selected channels, in the order of the layout
+  len = pack_sample_frame(frame, 0, 0, INA228_CH_DIE_TEMP | INA228_CH_CHARGE,
+                          0, 2, meas, energy_deltas, latch_offsets_us);
+  TEST_ASSERT_EQUAL(BIN_HEADER_LEN + 2 * (2 + 5 + 4) + 2, len);
+  const uint8_t sensor_1[] = {
+      0xFF, 0xFF,                   // Die temperature
+      0xFD, 0xFF, 0xFF, 0xFF, 0xFF, // Charge, 40-bit two's complement
+      0x00, 0x00, 0x00, 0x80,       // Latch offset INT32_MIN
+  };
+  TEST_ASSERT_EQUAL_HEX8_ARRAY(sensor_1, frame + BIN_HEADER_LEN + 11, 11);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_pack_le);
+  RUN_TEST(test_pack_float);
+  RUN_TEST(test_crc16_ccitt);
+  RUN_TEST(test_pack_sample_frame);
+  return UNITY_END();
+}
@@ -0,0 +1,270 @@
+/*
+Native tests of the Adafruit_INA228 driver against a fake I2C bus: the
+scaling of the raw register counts, the number of bus transactions per
+measurement and per configuration change, and the coherence check of
+snapshots.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#include <unity.h>
+
+#include "Adafruit_INA228.h"
+#include "FakeINA228.h"
+
+const uint8_t ADDRESS = 0x40;
+const float MAX_CURRENT = 0.2; // [A] As in `main.cpp`
+
+Adafruit_INA228 ina228;
+
+void setUp() {
+  Wire = TwoWire();
+  fake_ina228(Wire, ADDRESS);
+  TEST_ASSERT_TRUE(ina228.begin(ADDRESS, &Wire, true));
+  ina228.setCalibration(0.015, MAX_CURRENT, 1);
+  Wire.reset_counters();
+}
+
+void tearDown() {}
+
+/*------------------------------------------------------------------------------
+  begin()
+------------------------------------------------------------------------------*/
+
+void test_begin_absent_chip() {
+  Wire.remove_device(ADDRESS);
+  TEST_ASSERT_FALSE(ina228.begin(ADDRESS, &Wire, true));
+}
+
+void test_begin_wrong_chip() {
+  Wire.set_register(ADDRESS, INA228_REG_DVC_UID, 0x2271, 2); // INA227?
+  TEST_ASSERT_FALSE(ina228.begin(ADDRESS, &Wire, true));
+}
+
+void test_begin_reset_clears_rst() {
+  TEST_ASSERT_TRUE(ina228.begin(ADDRESS, &Wire, false));
+  TEST_ASSERT_EQUAL_HEX16(0x0000,
+                          Wire.get_register(ADDRESS, INA228_REG_CONFIG));
+  TEST_ASSERT_EQUAL(INA228_MODE_CONTINUOUS, ina228.getMode());
+}
+
+/*------------------------------------------------------------------------------
+  Scaling
+------------------------------------------------------------------------------*/
+
+void test_scale_current() {
+  // Half of full scale either way, and the sign extension of 20 bits
+  TEST_ASSERT_EQUAL_INT32(100000, ina228.currentRawTo_uA(1L << 18));
+  TEST_ASSERT_EQUAL_INT32(-100000, ina228.currentRawTo_uA(-(1L << 18)));
+  fake_ina228_results(Wire, ADDRESS, -(1L << 18), 0, 0);
+  TEST_ASSERT_EQUAL_INT32(-(1L << 18), ina228.readCurrentRaw());
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, -100.0, ina228.readCurrent());
+}
+
+void test_scale_bus_voltage() {
+  // 195.3125 uV per count
+  TEST_ASSERT_EQUAL_INT32(1000000, ina228.busVoltageRawTo_uV(5120));
+  TEST_ASSERT_EQUAL_INT32(195, ina228.busVoltageRawTo_uV(1));
+  fake_ina228_results(Wire, ADDRESS, 0, 0xFFFFF, 0);
+  TEST_ASSERT_EQUAL_UINT32(0xFFFFF, ina228.readBusVoltageRaw());
+}
+
+void test_scale_energy() {
+  // 16 * 3.2 * current LSB = 19.53125 uJ per count, over the full 40 bits
+  TEST_ASSERT_EQUAL_UINT64(20000, ina228.energyRawTo_uJ(1024));
+  TEST_ASSERT_EQUAL_UINT64(21474836460000ULL,
+                           ina228.energyRawTo_uJ((1ULL << 40) - 1024));
+  fake_ina228_results(Wire, ADDRESS, 0, 0, 0xFFFFFFFFFFULL);
+  TEST_ASSERT_EQUAL_UINT64(0xFFFFFFFFFFULL, ina228.readEnergyRaw());
+}
+
+void test_scale_charge() {
+  // One current LSB per count, and the sign extension of 40 bits
+  TEST_ASSERT_EQUAL_INT64(200000, ina228.chargeRawTo_uC(1L << 19));
+  TEST_ASSERT_EQUAL_INT64(-200000, ina228.chargeRawTo_uC(-(1L << 19)));
+  fake_ina228_results(Wire, ADDRESS, 0, 0, 0, 0, 0, -(1LL << 39));
+  TEST_ASSERT_EQUAL_INT64(-(1LL << 39), ina228.readChargeRaw());
+  fake_ina228_results(Wire, ADDRESS, 0, 0, 0, 0, 0, (1LL << 39) - 1);
+  TEST_ASSERT_EQUAL_INT64((1LL << 39) - 1, ina228.readChargeRaw());
+}
+
+void test_measurement_all_channels() {
+  fake_ina228_results(Wire, ADDRESS, 12345, 5120, 1024, 640, 3200, -(1L << 20));
+  INA228_Measurement meas;
+  TEST_ASSERT_TRUE(ina228.readMeasurement(meas, INA228_CH_ALL));
+  TEST_ASSERT_EQUAL_INT32(12345, meas.current_raw);
+  TEST_ASSERT_EQUAL_UINT32(5120, meas.bus_voltage_raw);
+  TEST_ASSERT_EQUAL_UINT64(1024, meas.energy_raw);
+  TEST_ASSERT_EQUAL_UINT32(640, meas.power_raw);
+  TEST_ASSERT_EQUAL_INT32(3200, meas.die_temp_raw);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 12345 * 0.2e3 / (1L << 19), meas.current);
+  TEST_ASSERT_FLOAT_WITHIN(1e-3, 1000.0, meas.bus_voltage);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, 0.02, meas.energy);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 640 * 3.2 * 0.2e3 / (1L << 19), meas.power);
+  TEST_ASSERT_FLOAT_WITHIN(1e-4, 25.0, meas.die_temp);
+  TEST_ASSERT_EQUAL_INT64(-(1L << 20), meas.charge_raw);
+  TEST_ASSERT_FLOAT_WITHIN(1e-6, -0.4, meas.charge);
+}
+
+void test_measurement_fails_on_nack() {
+  INA228_Measurement meas;
+  Wire.fail(ADDRESS, 1);
+  TEST_ASSERT_FALSE(ina228.readMeasurement(meas));
+  TEST_ASSERT_TRUE(ina228.readMeasurement(meas));
+}
+
+/*------------------------------------------------------------------------------
+  Transactions
+------------------------------------------------------------------------------*/
+
+void test_transactions_per_measurement() {
+  // Every register costs a pointer write and a read, the pointer of the
+  // INA228 not auto-incrementing
+  const struct {
+    uint8_t channels;
+    uint32_t n_registers;
+    uint32_t n_bytes_read;
+  } cases[] = {
+      {INA228_CH_CURRENT, 1, 3},
+      {INA228_CH_DEFAULT, 3, 11},
+      {INA228_CH_ALL, 6, 21},
+  };
+  INA228_Measurement meas;
+  for (const auto &c : cases) {
+    Wire.reset_counters();
+    TEST_ASSERT_TRUE(ina228.readMeasurement(meas, c.channels));
+    TEST_ASSERT_EQUAL_UINT32(c.n_registers, Wire.n_writes);
+    TEST_ASSERT_EQUAL_UINT32(c.n_registers, Wire.n_reads);
+    TEST_ASSERT_EQUAL_UINT32(c.n_registers, Wire.n_bytes_written);
+    TEST_ASSERT_EQUAL_UINT32(c.n_bytes_read, Wire.n_bytes_read);
+  }
+}
+
+void test_jobs_match_measurement() {
+  // The jobs of a background sweep read the same registers, and decode into
+  // the same values
+  fake_ina228_results(Wire, ADDRESS, -54321, 4321, 987654321, 1234, -100,
+                      -123456789);
+  INA228_Measurement blocking, background;
+  TEST_ASSERT_TRUE(ina228.readMeasurement(blocking, INA228_CH_ALL));
+
+  Adafruit_I2CAsyncJob jobs[6];
+  TEST_ASSERT_EQUAL_UINT8(6, ina228.measurementJobs(jobs, INA228_CH_ALL));
+  const uint8_t regs[] = {INA228_REG_CURRENT, INA228_REG_VBUS,
+                          INA228_REG_ENERGY,  INA228_REG_POWER,
+                          INA228_REG_DIETEMP, INA228_REG_CHARGE};
+  for (uint8_t i = 0; i < 6; i++) {
+    TEST_ASSERT_EQUAL_HEX8(ADDRESS, jobs[i].addr);
+    TEST_ASSERT_EQUAL_HEX8(regs[i], jobs[i].reg);
+    memset(jobs[i].dest, 0, jobs[i].len);
+    Wire.beginTransmission(jobs[i].addr);
+    Wire.write(jobs[i].reg);
+    Wire.endTransmission(false);
+    Wire.requestFrom(jobs[i].addr, jobs[i].len);
+    for (uint8_t j = 0; j < jobs[i].len; j++) {
+      jobs[i].dest[j] = Wire.read();
+    }
+  }
+  ina228.decodeMeasurement(background, INA228_CH_ALL);
+  TEST_ASSERT_EQUAL_INT32(blocking.current_raw, background.current_raw);
+  TEST_ASSERT_EQUAL_UINT32(blocking.bus_voltage_raw,
+                           background.bus_voltage_raw);
+  TEST_ASSERT_EQUAL_UINT64(blocking.energy_raw, background.energy_raw);
+  TEST_ASSERT_EQUAL_UINT32(blocking.power_raw, background.power_raw);
+  TEST_ASSERT_EQUAL_INT32(blocking.die_temp_raw, background.die_temp_raw);
+  TEST_ASSERT_EQUAL_INT64(blocking.charge_raw, background.charge_raw);
+}
+
+/*------------------------------------------------------------------------------
+  Snapshots
+------------------------------------------------------------------------------*/
+
+void test_snapshot_coherent() {
+  // Clearing and checking the conversion-ready flag, around the registers
+  fake_ina228_results(Wire, ADDRESS, 12345, 5120, 1024, 640);
+  INA228_Measurement meas;
+  bool coherent = false;
+  TEST_ASSERT_TRUE(ina228.readSnapshot(meas, INA228_CH_DEFAULT, &coherent));
+  TEST_ASSERT_TRUE(coherent);
+  TEST_ASSERT_EQUAL_INT32(12345, meas.current_raw);
+  TEST_ASSERT_EQUAL_UINT32(5, Wire.n_reads);
+  TEST_ASSERT_EQUAL_UINT32(15, Wire.n_bytes_read);
+}
+
+void test_snapshot_retries_once() {
+  // A conversion finishing during every attempt, as when reading out takes
+  // longer than a conversion period
+  Wire.set_register(ADDRESS, INA228_REG_DIAGALRT, 0x0003, 2); // CNVRF
+  INA228_Measurement meas;
+  bool coherent = true;
+  TEST_ASSERT_TRUE(ina228.readSnapshot(meas, INA228_CH_DEFAULT, &coherent));
+  TEST_ASSERT_FALSE(coherent);
+  TEST_ASSERT_EQUAL_UINT32(1 + 2 * (3 + 1), Wire.n_reads);
+}
+
+void test_snapshot_jobs() {
+  // The jobs of measurementJobs() between two reads of DIAG_ALRT
+  Adafruit_I2CAsyncJob jobs[5];
+  TEST_ASSERT_EQUAL_UINT8(5, ina228.snapshotJobs(jobs, INA228_CH_DEFAULT));
+  TEST_ASSERT_EQUAL_HEX8(INA228_REG_DIAGALRT, jobs[0].reg);
+  TEST_ASSERT_EQUAL_HEX8(INA228_REG_CURRENT, jobs[1].reg);
+  TEST_ASSERT_EQUAL_HEX8(INA228_REG_ENERGY, jobs[3].reg);
+  TEST_ASSERT_EQUAL_HEX8(INA228_REG_DIAGALRT, jobs[4].reg);
+  TEST_ASSERT_TRUE(jobs[0].dest == jobs[4].dest);
+
+  jobs[4].dest[0] = 0x00;
+  jobs[4].dest[1] = 0x03; // CNVRF
+  TEST_ASSERT_FALSE(ina228.snapshotCoherent());
+  jobs[4].dest[1] = 0x01;
+  TEST_ASSERT_TRUE(ina228.snapshotCoherent());
+}
+
+void test_adc_config_single_write() {
+  ina228.setADCConfig(INA228_MODE_CONTINUOUS, INA228_TIME_150_us,
+                      INA228_TIME_280_us, INA228_TIME_50_us, INA228_COUNT_16);
+  TEST_ASSERT_EQUAL_UINT32(1, Wire.n_transactions());
+  TEST_ASSERT_EQUAL(INA228_TIME_280_us, ina228.getCurrentConversionTime());
+  TEST_ASSERT_EQUAL(INA228_COUNT_16, ina228.getAveragingCount());
+
+  // Served from RAM from here on, and not written again when unchanged
+  ina228.setADCConfig(INA228_MODE_CONTINUOUS, INA228_TIME_150_us,
+                      INA228_TIME_280_us, INA228_TIME_50_us, INA228_COUNT_16);
+  TEST_ASSERT_EQUAL_UINT32(1, Wire.n_transactions());
+  TEST_ASSERT_EQUAL_HEX16(0xF4C2,
+                          Wire.get_register(ADDRESS, INA228_REG_ADCCFG));
+}
+
+void test_calibration_unchanged_no_writes() {
+  ina228.setCalibration(0.015, MAX_CURRENT, 1);
+  TEST_ASSERT_EQUAL_UINT32(0, Wire.n_transactions());
+  ina228.setCalibration(0.020, MAX_CURRENT, 1);
+  TEST_ASSERT_EQUAL_UINT32(1, Wire.n_transactions()); // SHUNT_CAL only
+}
+
+void test_trigger_single_write() {
+  TEST_ASSERT_TRUE(ina228.triggerConversion());
+  TEST_ASSERT_EQUAL_UINT32(1, Wire.n_writes);
+  TEST_ASSERT_EQUAL_UINT32(0, Wire.n_reads);
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_begin_absent_chip);
+  RUN_TEST(test_begin_wrong_chip);
+  RUN_TEST(test_begin_reset_clears_rst);
+  RUN_TEST(test_scale_current);
+  RUN_TEST(test_scale_bus_voltage);
+  RUN_TEST(test_scale_energy);
+  RUN_TEST(test_scale_charge);
+  RUN_TEST(test_measurement_all_channels);
+  RUN_TEST(test_measurement_fails_on_nack);
+  RUN_TEST(test_transactions_per_measurement);
+  RUN_TEST(test_jobs_match_measurement);
+  RUN_TEST(test_snapshot_coherent);
+  RUN_TEST(test_snapshot_retries_once);
+  RUN_TEST(test_snapshot_jobs);
+  RUN_TEST(test_adc_config_single_write);
+  RUN_TEST(test_calibration_unchanged_no_writes);
+  RUN_TEST(test_trigger_single_write);
+  return UNITY_END();
+}
@@ -0,0 +1,146 @@
+/*
+Native tests of `SensorBank.h` against a fake I2C bus: the bus transactions
+of a sweep, the layout of the transfer jobs over two buses, the marking down
+of sensors that stop responding and the counting of torn snapshots.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#include <unity.h>
+
+#include "FakeINA228.h"
+#include "SensorBank.h"
+
+// Same table as in `main.cpp`
+typedef SensorBank<INA228_CH_ALL, 0x40, 0x41, 0x44, 0x45, 0x43, 0x4c> Bank;
+const size_t N = Bank::N;
+
+// Two sensors on `Wire` and one on `Wire1`
+typedef SensorBank<INA228_CH_ALL, 0x40, on_bus(1, 0x40), 0x41> SplitBank;
+
+TwoWire *const buses[SENSOR_BANK_MAX_BUSES] = {&Wire, &Wire1};
+
+Bank bank;
+
+template <typename T> void begin_bank(T &b) {
+  for (size_t i = 0; i < T::N; i++) {
+    TwoWire &wire = *buses[T::bus(i)];
+    fake_ina228(wire, T::address(i));
+    fake_ina228_results(wire, T::address(i), 1000 * (i + 1), 5120, 0);
+    TEST_ASSERT_TRUE(b.sensors[i].begin(T::address(i), &wire, true));
+    b.sensors[i].setCalibration(0.015, 0.2, 1);
+  }
+  b.prepare_jobs();
+}
+
+void setUp() {
+  Wire = TwoWire();
+  Wire1 = TwoWire();
+  bank = Bank();
+  begin_bank(bank);
+  Wire.reset_counters();
+}
+
+void tearDown() {}
+
+void test_sweep_transactions() {
+  // A pointer write and a read per register of every sensor
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32(N * 3, Wire.n_writes);
+  TEST_ASSERT_EQUAL_UINT32(N * 3, Wire.n_reads);
+  TEST_ASSERT_EQUAL_UINT32(N * 11, Wire.n_bytes_read);
+  TEST_ASSERT_EQUAL_HEX32(Bank::ALL, bank.fresh_mask());
+  for (size_t i = 0; i < N; i++) {
+    TEST_ASSERT_EQUAL_INT32(1000 * (i + 1), bank.meas[i].current_raw);
+  }
+
+  TEST_ASSERT_TRUE(bank.set_channels(INA228_CH_CURRENT));
+  Wire.reset_counters();
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32(N * 2, Wire.n_transactions());
+  TEST_ASSERT_EQUAL_UINT32(N * 3, Wire.n_bytes_read);
+}
+
+void test_jobs_per_bus() {
+  SplitBank split;
+  begin_bank(split);
+  TEST_ASSERT_EQUAL_UINT8(2 * 3, split.n_bus_jobs(0));
+  TEST_ASSERT_EQUAL_UINT8(1 * 3, split.n_bus_jobs(1));
+  TEST_ASSERT_EQUAL_HEX8(0x40, split.bus_jobs(0)[0].addr);
+  TEST_ASSERT_EQUAL_HEX8(0x41, split.bus_jobs(0)[3].addr);
+  TEST_ASSERT_EQUAL_HEX8(0x40, split.bus_jobs(1)[0].addr);
+
+  Wire.reset_counters();
+  Wire1.reset_counters();
+  TEST_ASSERT_TRUE(split.read());
+  TEST_ASSERT_EQUAL_UINT32(2 * 3 * 2, Wire.n_transactions());
+  TEST_ASSERT_EQUAL_UINT32(1 * 3 * 2, Wire1.n_transactions());
+}
+
+void test_retry_recovers() {
+  // A single NACK costs a retry of that sensor, not a failed read
+  Wire.fail(0x44, 1);
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_HEX32(Bank::ALL, bank.fresh_mask());
+  TEST_ASSERT_EQUAL_UINT32(0, bank.errors(2));
+  TEST_ASSERT_EQUAL_UINT32(N * 3 + 1, Wire.n_writes);
+}
+
+void test_sensor_goes_down() {
+  Wire.fail(0x44, 1000);
+  for (uint8_t i = 0; i < Bank::MAX_FAILURES; i++) {
+    TEST_ASSERT_TRUE(bank.up(2));
+    TEST_ASSERT_FALSE(bank.read());
+    TEST_ASSERT_EQUAL_HEX32(Bank::ALL & ~(1UL << 2), bank.fresh_mask());
+  }
+  TEST_ASSERT_FALSE(bank.up(2));
+  TEST_ASSERT_EQUAL_UINT32(Bank::MAX_FAILURES, bank.errors(2));
+  TEST_ASSERT_EQUAL_HEX32(1UL << 2, bank.take_went_down());
+  TEST_ASSERT_EQUAL_HEX32(0, bank.take_went_down());
+
+  // Left out of the sweeps and the jobs from here on
+  Wire.reset_counters();
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32((N - 1) * 3, Wire.n_writes);
+  TEST_ASSERT_EQUAL_UINT8((N - 1) * 3, bank.n_bus_jobs(0));
+
+  bank.set_up(2, true);
+  TEST_ASSERT_EQUAL_UINT8(N * 3, bank.n_bus_jobs(0));
+}
+
+void test_jobs_done_accounting() {
+  // The fifth job of the bus failed: sensor 0 completed, sensor 1 did
+  // not, the others did not get read
+  bank.clear_fresh();
+  bank.jobs_done(0, 4);
+  TEST_ASSERT_EQUAL_HEX32(0x01, bank.fresh_mask());
+  TEST_ASSERT_EQUAL_UINT32(0, bank.errors(0));
+  TEST_ASSERT_EQUAL_UINT32(1, bank.errors(1));
+  TEST_ASSERT_EQUAL_UINT32(0, bank.errors(2));
+}
+
+void test_snapshot_torn() {
+  // Two extra jobs per sensor, and a conversion that finished during the
+  // read-out gets counted
+  bank.set_snapshot(true);
+  TEST_ASSERT_EQUAL_UINT8(N * 5, bank.n_bus_jobs(0));
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_UINT32(0, bank.torn(1));
+
+  Wire.set_register(0x41, INA228_REG_DIAGALRT, 0x0003, 2); // CNVRF
+  TEST_ASSERT_TRUE(bank.read());
+  TEST_ASSERT_EQUAL_HEX32(Bank::ALL, bank.fresh_mask());
+  TEST_ASSERT_EQUAL_UINT32(1, bank.torn(1));
+  TEST_ASSERT_EQUAL_UINT32(0, bank.torn(0));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_sweep_transactions);
+  RUN_TEST(test_jobs_per_bus);
+  RUN_TEST(test_retry_recovers);
+  RUN_TEST(test_sensor_goes_down);
+  RUN_TEST(test_jobs_done_accounting);
+  RUN_TEST(test_snapshot_torn);
+  return UNITY_END();
+}
@@ -0,0 +1,119 @@
+/*
+Native tests of DvG_SerialCommand against a scripted serial port: splitting
+commands into arguments, dispatching them and the handling of partial input.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#include <unity.h>
+
+#include "DvG_SerialCommand.h"
+
+Stream port;
+DvG_SerialCommand *sc;
+
+// Arguments of the last handled command, joined by '|'
+std::string handled;
+uint8_t handled_argc;
+
+void record(uint8_t argc, char **argv) {
+  handled.clear();
+  for (uint8_t i = 0; i < argc; i++) {
+    handled += (i > 0) ? "|" : "";
+    handled += argv[i];
+  }
+  handled_argc = argc;
+}
+
+const DvG_Command COMMANDS[] = {
+    {"on", record},
+    {"cfg", record},
+};
+
+void setUp() {
+  port = Stream();
+  sc = new DvG_SerialCommand(port);
+  sc->setCommands(COMMANDS, sizeof(COMMANDS) / sizeof(COMMANDS[0]));
+  handled.clear();
+  handled_argc = 0;
+}
+
+void tearDown() { delete sc; }
+
+void test_dispatch_arguments() {
+  port.feed("cfg  ct=50 avg=4\r\n");
+  TEST_ASSERT_TRUE(sc->dispatch());
+  TEST_ASSERT_EQUAL_UINT8(3, handled_argc);
+  TEST_ASSERT_EQUAL_STRING("cfg|ct=50|avg=4", handled.c_str());
+}
+
+void test_dispatch_max_args() {
+  port.feed("on 1 2 3 4 5 6 7 8 9\n");
+  TEST_ASSERT_TRUE(sc->dispatch());
+  TEST_ASSERT_EQUAL_UINT8(MAX_ARGS, handled_argc);
+}
+
+void test_unknown_command() {
+  port.feed("off\n");
+  TEST_ASSERT_FALSE(sc->dispatch());
+  TEST_ASSERT_EQUAL_STRING("ERROR: Unknown command 'off'\r\n",
+                           port.output.c_str());
+}
+
+void test_empty_command() {
+  port.feed("  \n");
+  TEST_ASSERT_FALSE(sc->dispatch());
+  TEST_ASSERT_TRUE(port.output.empty());
+}
+
+void test_partial_input() {
+  // A command split over several reads of the port
+  port.feed("c");
+  TEST_ASSERT_FALSE(sc->dispatch());
+  port.feed("fg ct=");
+  TEST_ASSERT_FALSE(sc->dispatch());
+  port.feed("84\n");
+  TEST_ASSERT_TRUE(sc->dispatch());
+  TEST_ASSERT_EQUAL_STRING("cfg|ct=84", handled.c_str());
+}
+
+void test_several_commands_at_once() {
+  // Characters following a command wait for the next dispatch
+  port.feed("on\ncfg avg=1\n");
+  TEST_ASSERT_TRUE(sc->dispatch());
+  TEST_ASSERT_EQUAL_STRING("on", handled.c_str());
+  TEST_ASSERT_TRUE(sc->dispatch());
+  TEST_ASSERT_EQUAL_STRING("cfg|avg=1", handled.c_str());
+  TEST_ASSERT_FALSE(sc->dispatch());
+}
+
+void test_overlong_command() {
+  // Gets terminated at the buffer size, the rest becomes the next command
+  std::string line = "on " + std::string(STR_LEN, 'x') + "\n";
+  port.feed(line.c_str());
+  TEST_ASSERT_TRUE(sc->dispatch());
+  TEST_ASSERT_EQUAL_STRING(("on|" + std::string(STR_LEN - 4, 'x')).c_str(),
+                           handled.c_str());
+  TEST_ASSERT_FALSE(sc->dispatch());
+  TEST_ASSERT_EQUAL_STRING("ERROR: Unknown command 'xxxx'\r\n",
+                           port.output.c_str());
+}
+
+void test_parse_float() {
+  char token[] = "thr=-12.5";
+  TEST_ASSERT_EQUAL_FLOAT(-12.5f, parseFloatInString(token, 4));
+  TEST_ASSERT_EQUAL_FLOAT(0.0f, parseFloatInString(token, 9));
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_dispatch_arguments);
+  RUN_TEST(test_dispatch_max_args);
+  RUN_TEST(test_unknown_command);
+  RUN_TEST(test_empty_command);
+  RUN_TEST(test_partial_input);
+  RUN_TEST(test_several_commands_at_once);
+  RUN_TEST(test_overlong_command);
+  RUN_TEST(test_parse_float);
+  return UNITY_END();
+}
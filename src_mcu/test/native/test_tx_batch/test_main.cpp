@@ -0,0 +1,83 @@
+/*
+Native tests of `TxBatch.h`: frames collected whole into a single write, and
+the flush once the oldest frame waited long enough.
+
+Dennis van Gils, 14-10-2026
+*/
+
+#include <unity.h>
+
+#include "TxBatch.h"
+
+// Serial port that counts the writes it gets
+class CountingPrint : public Print {
+public:
+  uint32_t n_writes = 0;
+
+  size_t write(const uint8_t *buffer, size_t len) override {
+    n_writes++;
+    return Print::write(buffer, len);
+  }
+};
+
+TxBatch<64> batch;
+CountingPrint port;
+uint8_t frame[40];
+
+void setUp() {
+  batch = TxBatch<64>();
+  port = CountingPrint();
+  for (size_t i = 0; i < sizeof(frame); i++) {
+    frame[i] = (uint8_t)i;
+  }
+}
+
+void tearDown() {}
+
+void test_frames_stay_whole() {
+  TEST_ASSERT_TRUE(batch.append(frame, 30));
+  TEST_ASSERT_TRUE(batch.append(frame, 30));
+  TEST_ASSERT_FALSE(batch.append(frame, 30)); // Would not fit as a whole
+  TEST_ASSERT_EQUAL_size_t(60, batch.size());
+
+  batch.flush(port);
+  TEST_ASSERT_EQUAL_UINT32(1, port.n_writes);
+  TEST_ASSERT_EQUAL_size_t(60, port.output.size());
+  TEST_ASSERT_EQUAL_size_t(0, batch.size());
+  TEST_ASSERT_EQUAL_HEX8(29, (uint8_t)port.output[59]);
+
+  // Nothing to write
+  batch.flush(port);
+  TEST_ASSERT_EQUAL_UINT32(1, port.n_writes);
+}
+
+void test_due_by_age() {
+  TEST_ASSERT_FALSE(batch.due(2000));
+  batch.append(frame, 10);
+  fake_advance_us(1999);
+  TEST_ASSERT_FALSE(batch.due(2000));
+  batch.append(frame, 10); // Does not restart the wait
+  fake_advance_us(1);
+  TEST_ASSERT_TRUE(batch.due(2000));
+
+  batch.flush(port);
+  TEST_ASSERT_FALSE(batch.due(2000));
+}
+
+void test_counters() {
+  batch.append(frame, 40);
+  batch.flush(port);
+  batch.count(100); // A direct write, bypassing the batch
+  TEST_ASSERT_EQUAL_UINT32(140, batch.n_bytes());
+  TEST_ASSERT_EQUAL_UINT32(2, batch.n_writes());
+  batch.reset_counters();
+  TEST_ASSERT_EQUAL_UINT32(0, batch.n_bytes());
+}
+
+int main(int argc, char **argv) {
+  UNITY_BEGIN();
+  RUN_TEST(test_frames_stay_whole);
+  RUN_TEST(test_due_by_age);
+  RUN_TEST(test_counters);
+  return UNITY_END();
+}
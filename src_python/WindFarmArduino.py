@@ -10,6 +10,9 @@ __date__ = "14-11-2024"
 __version__ = "2.0"
 # pylint: disable=missing-docstring
 
+import binascii
+import time
+
 import serial
 import numpy as np
 
@@ -17,6 +20,128 @@ from dvg_devices.Arduino_protocol_serial import Arduino
 from dvg_debug_functions import print_fancy_traceback as pft
 from dvg_ringbuffer import RingBuffer
 
+# Number of INA228 sensors, must match `ina228_addresses` in `main.cpp`
+N_SENSORS = 6
+
+# [A] Maximum expected current, must match `MAX_CURRENT` in `main.cpp`
+MAX_CURRENT = 0.2
+
+# Scaling of the raw INA228 register counts as sent in binary stream mode
+CURRENT_LSB = MAX_CURRENT / 2**19 * 1e3  # [mA]
+VBUS_LSB = 195.3125e-3  # [mV]
+ENERGY_LSB = 16 * 3.2 * MAX_CURRENT / 2**19  # [J]
+POWER_LSB = 3.2 * CURRENT_LSB  # [mW]
+DIETEMP_LSB = 7.8125e-3  # ['C]
+CHARGE_LSB = MAX_CURRENT / 2**19  # [C]
+
+# Channels that can be selected with `set_channels()`, in the bit order of
+# `INA228_Channel`: letter, register length in binary frames [bytes], signed,
+# scaling of the register counts. Energy comes as an increment since the
+# previous frame.
+CHANNELS = (
+    ("I", 3, True, CURRENT_LSB),
+    ("V", 3, False, VBUS_LSB),
+    ("E", 3, False, ENERGY_LSB),
+    ("P", 3, False, POWER_LSB),
+    ("T", 2, True, DIETEMP_LSB),
+    ("Q", 5, True, CHARGE_LSB),
+)
+
+# Binary frame layout, see `main.cpp`. The length depends on the selected
+# channels, of which the bitmask is found at offset `BIN_CHANNELS_POS`.
+BIN_SYNC = b"\xa5\x5a"  # Sync word 0x5AA5, little-endian
+BIN_HEADER_LEN = 16
+BIN_CHANNELS_POS = 14
+# Bitmask of the sensors at the slow profile of the adaptive scheduler
+BIN_SLOW_POS = 15
+# Latch offset of a sensor that did not deliver the sample, e.g. being down
+BIN_LATCH_OFFSET_MISSING = -(2**31)
+# Latch offset of a sensor at the slow profile of the adaptive scheduler that
+# had no new data for the sample, its values repeat its last sample
+BIN_LATCH_OFFSET_STALE = -(2**31) + 1
+
+
+def bin_frame_len(channels: int) -> int:
+    """Length [bytes] of a binary frame carrying the bitmask `channels`"""
+    sensor_len = 4  # Latch offset
+    for bit, (_letter, length, _signed, _lsb) in enumerate(CHANNELS):
+        if channels & (1 << bit):
+            sensor_len += length
+    return BIN_HEADER_LEN + N_SENSORS * sensor_len + 2
+
+
+# Summary frame layout when decimating, see `main.cpp`
+BIN_SYNC_SUMMARY = b"\xa6\x5a"  # Sync word 0x5AA6, little-endian
+BIN_SUMMARY_HEADER_LEN = 18
+BIN_SUMMARY_SENSOR_LEN = 52
+BIN_SUMMARY_FRAME_LEN = (
+    BIN_SUMMARY_HEADER_LEN + N_SENSORS * BIN_SUMMARY_SENSOR_LEN + 2
+)
+
+# Scope frame layout of a capture in scope mode, see `main.cpp`
+BIN_SYNC_SCOPE = b"\xa7\x5a"  # Sync word 0x5AA7, little-endian
+BIN_SCOPE_HEADER_LEN = 16
+BIN_SCOPE_SAMPLES = 32
+BIN_SCOPE_FRAME_LEN = BIN_SCOPE_HEADER_LEN + BIN_SCOPE_SAMPLES * 8 + 2
+
+# Number of values per sensor in a summary: I, V and P each as mean, min, max
+# and rms, followed by E
+SUMMARY_VALUES_PER_SENSOR = 13
+
+# Stages of the firmware main loop as reported by `query_stats()`, must match
+# `STAGE_NAMES` in `main.cpp`
+STAGE_NAMES = ("loop", "cmd", "poll", "trig", "sweep", "store", "send")
+
+# Sync words of all binary frame types
+BIN_SYNCS = (BIN_SYNC, BIN_SYNC_SUMMARY, BIN_SYNC_SCOPE)
+
+# Samples as decoded in bulk, with a field per `state` ring buffer
+SAMPLE_DTYPE = np.dtype(
+    [("time", float)]
+    + [
+        (f"{x}_{n}", float)
+        for x in ("I", "V", "E", "P", "T", "Q", "dt")
+        for n in range(1, N_SENSORS + 1)
+    ]
+    + [("slow", float)]
+)
+EMPTY_SAMPLES = np.empty(0, dtype=SAMPLE_DTYPE)
+
+
+def crc_ok(frame: bytes | memoryview) -> bool:
+    """Check the CRC-16 at the end of a binary frame, see `main.cpp`"""
+    crc = int.from_bytes(frame[-2:], "little")
+    return binascii.crc_hqx(frame[2:-2], 0xFFFF) == crc
+
+
+def unpack_le(cols: np.ndarray, signed: bool) -> np.ndarray:
+    """Little-endian integers of any length packed in the columns of bytes
+    `cols`, one integer per row
+    """
+    raw = np.zeros(len(cols), dtype=np.int64)
+    for i in range(cols.shape[1]):
+        raw |= cols[:, i].astype(np.int64) << (8 * i)
+    if signed:
+        sign = 1 << (8 * cols.shape[1] - 1)
+        raw = (raw ^ sign) - sign
+    return raw
+
+
+def make_samples(time: np.ndarray, columns: dict) -> np.ndarray:
+    """Assemble samples of `SAMPLE_DTYPE` from the timestamps `time` [s] and
+    `columns` mapping names like `I_1` onto arrays or scalars. Quantities that
+    are missing end up as NaN, except for the latch offsets and the bitmask
+    `slow` which end up 0.
+    """
+    samples = np.empty(len(time), dtype=SAMPLE_DTYPE)
+    samples["time"] = time
+    for n in range(1, N_SENSORS + 1):
+        for x in ("I", "V", "E", "P", "T", "Q"):
+            samples[f"{x}_{n}"] = columns.get(f"{x}_{n}", np.nan)
+        samples[f"dt_{n}"] = columns.get(f"dt_{n}", 0)
+    samples["slow"] = columns.get("slow", 0)
+    return samples
+
 
 class WindFarmArduino(Arduino):
     """Manages serial communication with an Arduino programmed as a wind
@@ -84,6 +209,49 @@ class WindFarmArduino(Arduino):
             self.P_6 = RingBuffer(capacity)
             """Power [mW]"""
 
+            self.T_1 = RingBuffer(capacity)
+            """Die temperature ['C]"""
+            self.T_2 = RingBuffer(capacity)
+            """Die temperature ['C]"""
+            self.T_3 = RingBuffer(capacity)
+            """Die temperature ['C]"""
+            self.T_4 = RingBuffer(capacity)
+            """Die temperature ['C]"""
+            self.T_5 = RingBuffer(capacity)
+            """Die temperature ['C]"""
+            self.T_6 = RingBuffer(capacity)
+            """Die temperature ['C]"""
+
+            self.Q_1 = RingBuffer(capacity)
+            """Accumulated charge [C]"""
+            self.Q_2 = RingBuffer(capacity)
+            """Accumulated charge [C]"""
+            self.Q_3 = RingBuffer(capacity)
+            """Accumulated charge [C]"""
+            self.Q_4 = RingBuffer(capacity)
+            """Accumulated charge [C]"""
+            self.Q_5 = RingBuffer(capacity)
+            """Accumulated charge [C]"""
+            self.Q_6 = RingBuffer(capacity)
+            """Accumulated charge [C]"""
+
+            self.dt_1 = RingBuffer(capacity)
+            """Data latch time relative to `time` [us]"""
+            self.dt_2 = RingBuffer(capacity)
+            """Data latch time relative to `time` [us]"""
+            self.dt_3 = RingBuffer(capacity)
+            """Data latch time relative to `time` [us]"""
+            self.dt_4 = RingBuffer(capacity)
+            """Data latch time relative to `time` [us]"""
+            self.dt_5 = RingBuffer(capacity)
+            """Data latch time relative to `time` [us]"""
+            self.dt_6 = RingBuffer(capacity)
+            """Data latch time relative to `time` [us]"""
+
+            self.slow = RingBuffer(capacity)
+            """Bitmask of the sensors at the slow profile of the adaptive
+            scheduler, see `set_scheduler()`"""
+
             # fmt: off
             self._ringbuffers = [
                 self.time,
@@ -91,6 +259,11 @@ class WindFarmArduino(Arduino):
                 self.V_1, self.V_2, self.V_3, self.V_4, self.V_5, self.V_6,
                 self.E_1, self.E_2, self.E_3, self.E_4, self.E_5, self.E_6,
                 self.P_1, self.P_2, self.P_3, self.P_4, self.P_5, self.P_6,
+                self.T_1, self.T_2, self.T_3, self.T_4, self.T_5, self.T_6,
+                self.Q_1, self.Q_2, self.Q_3, self.Q_4, self.Q_5, self.Q_6,
+                self.dt_1, self.dt_2, self.dt_3, self.dt_4, self.dt_5,
+                self.dt_6,
+                self.slow,
             ]
             """List of all ring buffers"""
             # fmt: on
@@ -105,6 +278,7 @@ class WindFarmArduino(Arduino):
         long_name="Arduino",
         connect_to_specific_ID="Wind Farm",
         ring_buffer_capacity: int = 15,
+        binary_stream: bool = False,
     ):
         super().__init__(
             name=name,
@@ -115,19 +289,519 @@ class WindFarmArduino(Arduino):
         # Container for the measurement values
         self.state = self.State(capacity=ring_buffer_capacity)
 
+        self.binary_stream = binary_stream
+        """Request packed binary frames instead of ASCII rows from the Arduino
+        when DAQ gets turned on."""
+
+        self.transport = "cdc"
+        """Transport of the data over the serial port as negotiated with the
+        Arduino by `negotiate_transport()`"""
+
+        self.bin_seq = None
+        """Sequence counter of the last received binary frame"""
+        self.bin_dropped_frames = 0
+        """Number of binary frames that were lost or failed the CRC check, as
+        follows from the gaps in their sequence counters"""
+        self.bin_crc_errors = 0
+        """Number of binary frames that failed the CRC check. These show up in
+        `bin_dropped_frames` as well, except for scope frames."""
+        self.summary_seq = None
+        """Sequence counter of the last received binary summary frame"""
+        self._rx = b""
+        """Received bytes not yet decoded, the start of a frame or a line
+        still underway"""
+        self._pending = EMPTY_SAMPLES
+        """Decoded samples not yet appended to the `state` ring buffers"""
+
+        self.energy = [0.0] * N_SENSORS
+        """Energy [J] per sensor, summed from the increments in the binary
+        frames starting from the totals obtained by `query_energy()`"""
+
+        self.columns = [
+            f"{x}_{n}"
+            for n in range(1, N_SENSORS + 1)
+            for x in ("I", "V", "E", "dt")
+        ]
+        """Column names of the ASCII data rows following the time stamp, as
+        announced by the last header line from the Arduino"""
+
+        self.summary_count = 0
+        """Number of samples in the last received decimation window"""
+        self.summary = np.full((N_SENSORS, 3, 4), np.nan)
+        """Statistics of the last received decimation window, indexed as
+        [sensor, quantity, statistic] with quantity I [mA], V [mV], P [mW] and
+        statistic mean, min, max, rms. The means get appended to the `state`
+        ring buffers as well."""
+
     # --------------------------------------------------------------------------
     #   Arduino commands
     # --------------------------------------------------------------------------
 
     def turn_on(self) -> bool:
+        # Binary frames go out in large batches, when the Arduino supports it
+        self.negotiate_transport("raw" if self.binary_stream else "cdc")
+        if not self.write("bin" if self.binary_stream else "txt"):
+            return False
+        if self.binary_stream:
+            energy = self.query_energy()
+            if energy is None:
+                return False
+            self.energy = energy
+        self.bin_seq = None
+        self.summary_seq = None
+        self._rx = b""
+        self._pending = EMPTY_SAMPLES
         return self.write("on")
 
     def turn_off(self) -> bool:
         return self.write("off")
 
+    def negotiate_transport(self, transport: str = "raw") -> str:
+        """Ask the Arduino to send its data over `transport`: "cdc" writes out
+        every row and frame by itself, "raw" collects them into batches of
+        several USB packets, for the highest throughput. A firmware that does
+        not know about transports stays at "cdc". Turns DAQ off.
+
+        Returns the transport in effect, also stored in `transport`.
+        """
+        success, reply = self.query(f"id? {transport}")
+        parts = reply.strip().split("\t") if isinstance(reply, str) else []
+        if success and len(parts) == 2 and parts[1] in ("cdc", "raw"):
+            self.transport = parts[1]
+        else:
+            self.transport = "cdc"
+        return self.transport
+
+    def set_idle(self, on: bool = True) -> bool:
+        """Let the Arduino drop into low-power idle once DAQ has been off for
+        a second: the sensors get shut down and the microcontroller sleeps
+        between commands. `turn_on()` wakes it up again, at the cost of a few
+        ms plus a conversion period before the first sample, see
+        `query_idle()`. Energy does not accumulate while idling. Pass False to
+        keep the sensors converting.
+        """
+        return self.write("idle on" if on else "idle off")
+
+    def query_idle(self) -> dict | None:
+        """Query the low-power idle state of the Arduino, see `set_idle()`:
+        whether it is on, whether idling right now, the time [us] it took to
+        restore the configuration of the sensors when the last `turn_on()`
+        woke it up, 0 when it was awake already, and the time [us] from the
+        last `turn_on()` to the first sample, 0 while still waiting for it.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("idle?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            parts = reply.strip().split("\t")
+            return {
+                "on": parts[0] == "on",
+                "idling": parts[1] == "1",
+                "restore_us": int(parts[2]),
+                "first_sample_us": int(parts[3]),
+            }
+        except (ValueError, IndexError):
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def query_link(self) -> dict | None:
+        """Query the throughput of the serial link over the last time DAQ was
+        running: the transport, the bytes per second, the writes to the
+        serial port per second and the mean number of bytes per write.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("link?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            parts = reply.strip().split("\t")
+            return {
+                "transport": parts[0],
+                "bytes_per_s": int(parts[1]),
+                "writes_per_s": int(parts[2]),
+                "bytes_per_write": int(parts[3]),
+            }
+        except (ValueError, IndexError):
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
     def reset_accumulators(self) -> bool:
+        self.energy = [0.0] * N_SENSORS
         return self.write("r")
 
+    def query_energy(self) -> list[float] | None:
+        """Query the energy totals [J] of all sensors as accumulated by the
+        Arduino since the last `reset_accumulators()`. The energy increments
+        in the binary frames continue from these totals.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("E?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            return [float(x) for x in reply.strip().split("\t")]
+        except ValueError:
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def configure(
+        self,
+        ct: int | None = None,
+        vt: int | None = None,
+        tt: int | None = None,
+        avg: int | None = None,
+    ) -> str | None:
+        """Change the conversion times [us] of the shunt voltage `ct`, bus
+        voltage `vt` and die temperature `tt`, and the averaging count `avg`
+        of all INA228 sensors at once. Omitted settings are left unchanged.
+        Only send while DAQ is off.
+
+        Returns the reply of the Arduino reporting the active settings, the
+        resulting sample rate and a warning when the I2C bus or serial link
+        can not keep up, or None when communication failed.
+        """
+        cmd = "cfg"
+        for key, val in (("ct", ct), ("vt", vt), ("tt", tt), ("avg", avg)):
+            if val is not None:
+                cmd += f" {key}={val:d}"
+
+        success, reply = self.query(cmd)
+        return reply if success and isinstance(reply, str) else None
+
+    def calibrate(
+        self,
+        sensor: int | None = None,
+        r_shunt: float | None = None,
+        gain: float | None = None,
+        adc_range: int | None = None,
+    ) -> str | None:
+        """Change the shunt resistance `r_shunt` [Ohm] and the correction
+        factor `gain` of the current of INA228 sensor index `sensor`, or of
+        all sensors when omitted, and the shunt full scale ADC range
+        `adc_range` of all sensors (0: +/-163.84 mV or 1: +/-40.96 mV).
+        Omitted settings are left unchanged. Persist with `save_config()`.
+
+        Returns the reply of the Arduino reporting the ADC range and the
+        resistance and gain of every sensor, or None when communication
+        failed.
+        """
+        cmd = "cal"
+        for key, val in (
+            ("s", sensor),
+            ("r", r_shunt),
+            ("gain", gain),
+            ("range", adc_range),
+        ):
+            if val is not None:
+                cmd += f" {key}={val}"
+
+        success, reply = self.query(cmd)
+        return reply if success and isinstance(reply, str) else None
+
+    def query_calibration(self) -> dict | None:
+        """Query the shunt full scale ADC range of all sensors and the shunt
+        resistance [Ohm] and the correction factor of the current of each
+        sensor, see `calibrate()`. Maps "adc_range", "r_shunt" and "gain" onto
+        these.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("cal?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            parts = reply.strip().split("\t")
+            sensors = [
+                [float(x) for x in part.split(",")] for part in parts[1:]
+            ]
+            return {
+                "adc_range": int(parts[0].split("=")[1]),
+                "r_shunt": [r_shunt for r_shunt, _gain in sensors],
+                "gain": [gain for _r_shunt, gain in sensors],
+            }
+        except (ValueError, IndexError):
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def save_config(self, clear: bool = False) -> bool:
+        """Store the calibration and the ADC configuration in the flash of the
+        Arduino, to be applied at every boot. Pass `clear` to return to the
+        defaults from the next boot on.
+
+        Returns True when the Arduino confirmed, False otherwise.
+        """
+        success, reply = self.query("save clear" if clear else "save")
+        if not success or not isinstance(reply, str):
+            return False
+        return not reply.startswith("ERROR")
+
+    def query_health(self) -> list[tuple[bool, int]] | None:
+        """Query whether each INA228 sensor is up, and its number of failed
+        reads since boot. A sensor that is down is left out of the
+        acquisition, its values showing up as NaN, and gets probed again in
+        the background until it responds.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("health?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            health = []
+            for field in reply.strip().split("\t"):
+                state, errors = field.split("/")
+                health.append((state == "up", int(errors)))
+        except ValueError:
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+        return health
+
+    def set_triggered(self, triggered: bool = True) -> bool:
+        """Switch all INA228 sensors to one-shot conversions that get
+        triggered back to back, so that all sensors sample in phase. Pass
+        False to return to free-running conversions.
+        """
+        return self.write("trig" if triggered else "cont")
+
+    def query_skew(self) -> list[int] | None:
+        """Query the trigger offsets [us] of each sensor relative to sensor 0
+        of the last burst of triggers, followed by the largest trigger spread
+        [us] since DAQ got turned on. Only meaningful in triggered mode, see
+        `set_triggered()`.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("skew?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            return [int(x) for x in reply.strip().split("\t")]
+        except ValueError:
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def set_channels(self, channels: str = "I,V,E") -> bool:
+        """Select the INA228 result registers to read out and send for every
+        sensor, as a comma-separated list of I (current), V (bus voltage),
+        E (energy), P (power), T (die temperature) and Q (charge). Power and
+        charge come from the registers of the INA228, which derives them from
+        every single conversion. Quantities that are not selected end up as
+        NaN in the `state` ring buffers.
+        """
+        return self.write(f"ch {channels}")
+
+    def set_snapshots(self, on: bool = True) -> bool:
+        """Let the Arduino read out the selected registers of each sensor as
+        a snapshot of a single conversion cycle, checked by the
+        conversion-ready flag of the INA228. Pass False to read out the
+        registers as they come, at two register reads less per sensor.
+        """
+        return self.write("snap on" if on else "snap off")
+
+    def query_snapshots(self) -> dict | None:
+        """Query whether the Arduino reads out snapshots, see
+        `set_snapshots()`, and the number of snapshots per sensor that still
+        mixed two conversion cycles, e.g. when the conversions are set faster
+        than the bus can read them out.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("snap?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            parts = reply.strip().split("\t")
+            return {
+                "on": parts[0] == "on",
+                "torn": [int(x) for x in parts[1 : 1 + N_SENSORS]],
+            }
+        except (ValueError, IndexError):
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def set_sensor_timestamps(self, per_sensor: bool = True) -> bool:
+        """Let the Arduino timestamp each sensor at the moment it latched its
+        data, instead of timestamping sensor 0 only and reading out all
+        sensors at once. The latch times relative to `state.time` end up in
+        the `state.dt_n` ring buffers. Pass False to return to a single
+        timestamp per sample.
+        """
+        return self.write("ts sensor" if per_sensor else "ts row")
+
+    def set_scheduler(
+        self, on: bool | None = None, threshold: float | None = None
+    ) -> bool:
+        """Turn the adaptive scheduler of the Arduino on or off and/or set its
+        `threshold` [mA]. It drops each sensor of which the RMS deviation of
+        the current stays below the threshold to slow conversions with high
+        averaging, and those sensors only deliver a new sample now and then.
+        In between they repeat their last values with `state.dt_n` as NaN.
+        `state.slow` holds the bitmask of such sensors per sample. Needs
+        continuous acquisition with the current selected, see
+        `set_channels()`.
+        """
+        cmd = "sched"
+        if on is not None:
+            cmd += " on" if on else " off"
+        if threshold is not None:
+            cmd += f" thr={threshold}"
+        return self.write(cmd)
+
+    def query_scheduler(self) -> dict | None:
+        """Query the state of the adaptive scheduler of the Arduino: whether
+        it is on, the threshold [mA], the bitmask of sensors at the slow
+        profile, the sample rate [Hz] of that profile and the activity [mA]
+        of every sensor over the last window, NaN when not judged yet.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("sched?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            parts = reply.strip().split("\t")
+            return {
+                "on": parts[0] == "on",
+                "threshold": float(parts[1]),
+                "slow": int(parts[2]),
+                "slow_rate": float(parts[3]),
+                "activity": [float(x) for x in parts[4 : 4 + N_SENSORS]],
+            }
+        except (ValueError, IndexError):
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def decimate(self, n: int | None = None, t_ms: int | None = None) -> bool:
+        """Let the Arduino send out a single summary row per window of `n`
+        samples or of `t_ms` milliseconds, instead of every sample. Omit both
+        to send out every sample again.
+        """
+        if n is not None:
+            return self.write(f"dec n={n:d}")
+        if t_ms is not None:
+            return self.write(f"dec t={t_ms:d}")
+        return self.write("dec")
+
+    def query_ring(self) -> list[int] | None:
+        """Query the usage of the sample ring buffer of the Arduino: its
+        current fill, its high-water mark and capacity, and the number of
+        samples and of summary windows lost because the host lagged, the
+        latter two counted since DAQ got turned on.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("ring?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            return [int(x) for x in reply.strip().split("\t")]
+        except ValueError:
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def query_stats(self) -> dict[str, list[int]] | None:
+        """Query the latency statistics of each stage of the firmware main
+        loop, see `STAGE_NAMES`, accumulated since the last `reset_stats()`.
+        Maps the stage name onto its count, mean [us], max [us] and the counts
+        of the histogram buckets as described in `LatencyStats.h`.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("stats?")
+        stats = {}
+        for i in range(len(STAGE_NAMES)):
+            if i > 0:
+                success, reply = self.readline()
+            if not success or not isinstance(reply, str):
+                return None
+            parts = reply.strip().split("\t")
+            try:
+                stats[parts[0]] = [int(x) for x in parts[1:]]
+            except ValueError:
+                pft("Failed to convert Arduino data into numeric values.")
+                return None
+        return stats
+
+    def reset_stats(self) -> bool:
+        return self.write("stats r")
+
+    def set_benchmark(self, rate: int | None = None) -> bool:
+        """Let the Arduino generate samples by itself at `rate` [Hz], or as
+        fast as it can for a rate of 0, instead of reading out the sensors.
+        These run through the same ring buffer and serializer as the real
+        samples, to measure the throughput of the serial link. Pass None to
+        return to the sensors.
+        """
+        return self.write("bench off" if rate is None else f"bench {rate:d}")
+
+    def query_time(self) -> float | None:
+        """Query the current timestamp [s] of the Arduino on its local clock,
+        which `state.time` follows unless synced by `sync_clock()`.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("t?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            return float(reply)
+        except ValueError:
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def sync_clock(self, n_pings: int = 16) -> bool:
+        """Map the timestamps of the Arduino onto the clock of this PC,
+        `time.time()`, so that the data of several boards attached to this PC
+        share a common timebase. Pings the Arduino `n_pings` times and takes
+        the midpoint of the ping with the shortest round trip as the host time
+        at which the Arduino took its timestamp. Call again every minute or so
+        to let the Arduino fit the drift of its crystal as well, see `sync` in
+        `main.cpp`. Only while DAQ is off, as the replies would get mixed into
+        the data otherwise. From then on `state.time` counts seconds since the
+        Unix epoch.
+
+        Returns True when successful, False when communication failed.
+        """
+        best = None  # Round trip [ns], local time [us], host time [us]
+        for _ in range(n_pings):
+            t0 = time.time_ns()
+            local = self.query_time()
+            t1 = time.time_ns()
+            if local is None:
+                return False
+            if best is None or t1 - t0 < best[0]:
+                best = (t1 - t0, round(local * 1e6), (t0 + t1) // 2000)
+        if best is None:
+            return False
+        return self.write(f"sync {best[1]:d} {best[2]:d}")
+
+    def query_sync(self) -> tuple[float, int, int, int] | None:
+        """Query the state of the clock sync of the Arduino: the offset [s] of
+        the host clock relative to the local one, the drift [ppb] of the host
+        clock rate relative to the local one, the number of pings the fit runs
+        through and the largest residual [us] of these. All zero when not
+        synced.
+
+        Returns None when communication failed.
+        """
+        success, reply = self.query("sync?")
+        if not success or not isinstance(reply, str):
+            return None
+        try:
+            parts = reply.strip().split("\t")
+            return float(parts[0]), int(parts[1]), int(parts[2]), int(parts[3])
+        except (ValueError, IndexError):
+            pft("Failed to convert Arduino data into numeric values.")
+            return None
+
+    def reset_sync(self) -> bool:
+        """Return the timestamps of the Arduino to its local clock"""
+        return self.write("sync r")
+
     # --------------------------------------------------------------------------
     #   parse_readings
     # --------------------------------------------------------------------------
@@ -138,114 +812,499 @@ class WindFarmArduino(Arduino):
 
         Returns True when successful, False otherwise.
         """
-        parts = line.strip("\n").split("\t")
+        samples = self.decode_text_lines([line.strip("\r\n")])
+        if samples is None:
+            return False
+        self.store_samples(samples)
+        return True
 
-        try:
-            time_millis = int(parts[0])  # [ms]
-            time_micros = int(parts[1])  # [us] fraction
-            I_1 = float(parts[2])  # [mA]
-            V_1 = float(parts[3])  # [mV]
-            E_1 = float(parts[4])  # [J]
-            I_2 = float(parts[5])
-            V_2 = float(parts[6])
-            E_2 = float(parts[7])
-            I_3 = float(parts[8])
-            V_3 = float(parts[9])
-            E_3 = float(parts[10])
-            I_4 = float(parts[11])
-            V_4 = float(parts[12])
-            E_4 = float(parts[13])
-            I_5 = float(parts[14])
-            V_5 = float(parts[15])
-            E_5 = float(parts[16])
-            I_6 = float(parts[17])
-            V_6 = float(parts[18])
-            E_6 = float(parts[19])
-        except IndexError:
-            pft("Received an incorrect number of values from the Arduino.")
+    def parse_header(self, line: str) -> bool:
+        """Parse the header line `line` announcing the column names of the
+        ASCII data rows to follow, e.g. `#time\tI_1\tV_1\tdt_1\t...`.
+
+        Returns True when successful, False otherwise.
+        """
+        parts = line.strip("\r\n").lstrip("#").split("\t")
+        if parts[0] != "time":
+            pft("Received an invalid header line from the Arduino.")
             return False
+
+        self.columns = parts[1:]
+        return True
+
+    def decode_text_lines(self, lines: list[str]) -> np.ndarray | None:
+        """Decode the ASCII lines `lines` as received from the Arduino, minus
+        their line endings, into samples of `SAMPLE_DTYPE`. Header lines take
+        effect right away. Consecutive data rows get converted all at once.
+
+        Returns the samples, or None when none of the lines decoded.
+        """
+        batches = []
+        rows = []  # Fields of the data rows not yet converted
+        n_fields = 1 + len(self.columns)
+        success = False
+
+        for line in lines + ["#"]:  # The sentinel converts the last rows
+            parts = line.split("\t")
+            if not line.startswith("#") and len(parts) == n_fields:
+                rows.append(parts)
+                continue
+
+            if rows:
+                batch = self.decode_text_rows(rows)
+                success |= len(batch) > 0
+                batches.append(batch)
+                rows = []
+
+            if line == "#":
+                continue
+            if line.startswith("#"):
+                success |= self.parse_header(line)
+                n_fields = 1 + len(self.columns)
+            elif len(parts) == 2 + N_SENSORS * SUMMARY_VALUES_PER_SENSOR:
+                try:
+                    time = float(parts[0])  # [s]
+                    count = int(parts[1])
+                    values = np.array(parts[2:], dtype=float)
+                except ValueError:
+                    pft("Failed to convert Arduino data into numeric values.")
+                    continue
+                batches.append(self.summary_samples(time, count, values))
+                success = True
+            else:
+                pft("Received an incorrect number of values from the Arduino.")
+
+        if not success:
+            return None
+        return np.concatenate(batches) if batches else EMPTY_SAMPLES
+
+    def decode_text_rows(self, rows: list[list[str]]) -> np.ndarray:
+        """Convert the fields `rows` of data rows with the columns announced
+        by the last header line into samples of `SAMPLE_DTYPE`. Rows that fail
+        to convert get dropped.
+        """
+        try:
+            values = np.array(rows, dtype=float)
         except ValueError:
-            pft("Failed to convert Arduino data into numeric values.")
-            return False
+            # Find the culprits the slow way
+            good = []
+            for parts in rows:
+                try:
+                    good.append([float(x) for x in parts])
+                except ValueError:
+                    pft("Failed to convert Arduino data into numeric values.")
+            if not good:
+                return EMPTY_SAMPLES
+            values = np.array(good, dtype=float)
+
+        columns = {
+            name: values[:, i + 1] for i, name in enumerate(self.columns)
+        }
+        return make_samples(values[:, 0], columns)
 
-        # Derived
-        P_1 = np.maximum(I_1 * V_1 / 1e3, 0)  # [mW]
-        P_2 = np.maximum(I_2 * V_2 / 1e3, 0)
-        P_3 = np.maximum(I_3 * V_3 / 1e3, 0)
-        P_4 = np.maximum(I_4 * V_4 / 1e3, 0)
-        P_5 = np.maximum(I_5 * V_5 / 1e3, 0)
-        P_6 = np.maximum(I_6 * V_6 / 1e3, 0)
-
-        self.state.time.append(time_millis / 1e3 + time_micros / 1e6)
-
-        self.state.I_1.append(I_1)
-        self.state.V_1.append(V_1)
-        self.state.E_1.append(E_1)
-        self.state.P_1.append(P_1)
-
-        self.state.I_2.append(I_2)
-        self.state.V_2.append(V_2)
-        self.state.E_2.append(E_2)
-        self.state.P_2.append(P_2)
-
-        self.state.I_3.append(I_3)
-        self.state.V_3.append(V_3)
-        self.state.E_3.append(E_3)
-        self.state.P_3.append(P_3)
-
-        self.state.I_4.append(I_4)
-        self.state.V_4.append(V_4)
-        self.state.E_4.append(E_4)
-        self.state.P_4.append(P_4)
-
-        self.state.I_5.append(I_5)
-        self.state.V_5.append(V_5)
-        self.state.E_5.append(E_5)
-        self.state.P_5.append(P_5)
-
-        self.state.I_6.append(I_6)
-        self.state.V_6.append(V_6)
-        self.state.E_6.append(E_6)
-        self.state.P_6.append(P_6)
+    def summary_samples(
+        self,
+        time: float,
+        count: int,
+        values: np.ndarray,
+    ) -> np.ndarray:
+        """Store the statistics of a decimation window into `summary` and
+        return the means and the energy as a single sample of `SAMPLE_DTYPE`.
+        """
+        values = values.reshape(N_SENSORS, SUMMARY_VALUES_PER_SENSOR)
+        self.summary_count = count
+        self.summary = values[:, :12].reshape(N_SENSORS, 3, 4)
+
+        columns = {}
+        for idx in range(N_SENSORS):
+            n = idx + 1
+            columns[f"I_{n}"] = values[idx, 0]
+            columns[f"V_{n}"] = values[idx, 4]
+            columns[f"P_{n}"] = values[idx, 8]
+            columns[f"E_{n}"] = values[idx, 12]
+        return make_samples(np.array([time]), columns)
+
+    def store_samples(self, samples: np.ndarray):
+        """Append the samples `samples` of `SAMPLE_DTYPE` to the `state` ring
+        buffers, in bulk per ring buffer.
+        """
+        if len(samples) == 0:
+            return
+        for name in SAMPLE_DTYPE.names:
+            getattr(self.state, name).extend(samples[name])
+
+    # --------------------------------------------------------------------------
+    #   Binary stream mode
+    # --------------------------------------------------------------------------
+
+    def read_binary_frame(self) -> bytes | None:
+        """Read a single binary frame from the serial port, resynchronizing on
+        the sync word when needed.
+
+        Returns the full frame when it passed the CRC check, an empty bytes
+        object when it got corrupted, or None when communication timed out.
+        """
+        if self.ser is None:
+            return None
+
+        # Hunt for the sync word of either frame type
+        prev = b""
+        while True:
+            c = self.ser.read(1)
+            if c == b"":
+                return None
+            sync = prev + c
+            if sync in BIN_SYNCS:
+                break
+            prev = c
+
+        if sync == BIN_SYNC:
+            # The length follows from the channels given in the header
+            body = self.ser.read(BIN_HEADER_LEN - 2)
+            if len(body) != BIN_HEADER_LEN - 2:
+                return None
+            frame_len = bin_frame_len(body[BIN_CHANNELS_POS - 2])
+        else:
+            body = b""
+            frame_len = (
+                BIN_SUMMARY_FRAME_LEN
+                if sync == BIN_SYNC_SUMMARY
+                else BIN_SCOPE_FRAME_LEN
+            )
+
+        body += self.ser.read(frame_len - 2 - len(body))
+        if len(body) != frame_len - 2:
+            return None
+
+        crc = int.from_bytes(body[-2:], "little")
+        if binascii.crc_hqx(body[:-2], 0xFFFF) != crc:
+            self.bin_crc_errors += 1
+            return b""
+
+        return sync + body
+
+    def parse_binary_frame(self, frame: bytes) -> bool:
+        """Scale the raw register counts of a binary `frame` as received from
+        the Arduino and store these into the `state` ring buffers.
+
+        Returns True when successful, False otherwise.
+        """
+        if frame[:2] == BIN_SYNC_SCOPE:
+            return False  # Collected by `read_scope_capture()` instead
+        if frame[:2] == BIN_SYNC and len(frame) != bin_frame_len(
+            frame[BIN_CHANNELS_POS]
+        ):
+            pft("Received a binary frame of incorrect length.")
+            return False
+        if (
+            frame[:2] == BIN_SYNC_SUMMARY
+            and len(frame) != BIN_SUMMARY_FRAME_LEN
+        ):
+            pft("Received a binary summary frame of incorrect length.")
+            return False
 
+        samples, _consumed = self.decode_binary(frame)
+        if len(samples) == 0:
+            return False
+        self.store_samples(samples)
         return True
 
+    def decode_binary(self, data: bytes | bytearray) -> tuple[np.ndarray, int]:
+        """Decode all complete binary frames in the received bytes `data` at
+        once into samples of `SAMPLE_DTYPE`. Runs of frames of the same
+        layout get scaled as a whole, so that the cost per frame comes down to
+        a CRC check. Corrupted frames get counted in `bin_crc_errors` and the
+        decoding resynchronizes on the next sync word. The frames that did
+        not arrive intact get counted in `bin_dropped_frames` from the gaps
+        in the sequence counters. Scope frames get skipped.
+
+        Returns the samples and the number of bytes consumed. The bytes
+        beyond that are the start of a frame still underway.
+        """
+        buf = memoryview(data)  # Slices without copying
+        arr = np.frombuffer(data, dtype=np.uint8)
+        n_bytes = len(data)
+        batches = []
+        p = 0
+
+        while True:
+            # Hunt for the sync word of either frame type
+            found = [data.find(s, p) for s in BIN_SYNCS]
+            found = [x for x in found if x >= 0]
+            if not found:
+                # Keep a trailing byte that could be half a sync word
+                p = max(p, n_bytes - 1)
+                break
+            p = min(found)
+
+            sync = bytes(buf[p : p + 2])
+            if sync != BIN_SYNC:
+                frame_len = (
+                    BIN_SUMMARY_FRAME_LEN
+                    if sync == BIN_SYNC_SUMMARY
+                    else BIN_SCOPE_FRAME_LEN
+                )
+                if p + frame_len > n_bytes:
+                    break
+                frame = buf[p : p + frame_len]
+                if not crc_ok(frame):
+                    self.bin_crc_errors += 1
+                    p += 1
+                    continue
+                if sync == BIN_SYNC_SUMMARY:
+                    batches.append(self.decode_summary_frame(frame))
+                p += frame_len
+                continue
+
+            if p + BIN_HEADER_LEN > n_bytes:
+                break
+            channels = data[p + BIN_CHANNELS_POS]
+            frame_len = bin_frame_len(channels)
+            n_max = (n_bytes - p) // frame_len
+            if n_max == 0:
+                break
+
+            # Length of the run of frames with the same layout that follow
+            starts = p + frame_len * np.arange(n_max)
+            same = (
+                (arr[starts] == BIN_SYNC[0])
+                & (arr[starts + 1] == BIN_SYNC[1])
+                & (arr[starts + BIN_CHANNELS_POS] == channels)
+            )
+            n_run = n_max if same.all() else int(np.argmin(same))
+
+            good = np.array(
+                [crc_ok(buf[s : s + frame_len]) for s in starts[:n_run]]
+            )
+            self.bin_crc_errors += int(n_run - good.sum())
+            frames = arr[p : p + n_run * frame_len].reshape(n_run, frame_len)
+            if good.any():
+                batches.append(self.decode_sample_frames(frames[good]))
+
+            # Resynchronize inside a corrupted last frame, which might have
+            # lost bytes instead of having some flipped
+            p += n_run * frame_len if good[-1] else (n_run - 1) * frame_len + 1
+
+        samples = np.concatenate(batches) if batches else EMPTY_SAMPLES
+        return samples, p
+
+    def decode_sample_frames(self, frames: np.ndarray) -> np.ndarray:
+        """Scale the raw register counts of the binary sample frames `frames`,
+        passed as rows of bytes that share a single channel layout, into
+        samples of `SAMPLE_DTYPE`.
+        """
+        channels = int(frames[0, BIN_CHANNELS_POS])
+
+        seq = unpack_le(frames[:, 2:6], signed=False)
+        prev = np.empty_like(seq)
+        prev[0] = seq[0] - 1 if self.bin_seq is None else self.bin_seq
+        prev[1:] = seq[:-1]
+        self.bin_dropped_frames += int(((seq - prev - 1) & 0xFFFFFFFF).sum())
+        self.bin_seq = int(seq[-1])
+
+        time_us = unpack_le(frames[:, 6:14], signed=False)  # [us]
+
+        columns = {}
+        p = BIN_HEADER_LEN
+        for idx in range(N_SENSORS):
+            n = idx + 1
+            sensor = {}
+            for bit, (letter, length, signed, lsb) in enumerate(CHANNELS):
+                if channels & (1 << bit):
+                    raw = unpack_le(frames[:, p : p + length], signed=signed)
+                    sensor[letter] = raw * lsb
+                    p += length
+            dt = unpack_le(frames[:, p : p + 4], signed=True).astype(float)
+            p += 4
+
+            # Only the energy is known for a sensor that did not deliver,
+            # while a stale one repeats its last values
+            missing = dt == BIN_LATCH_OFFSET_MISSING
+            for letter, values in sensor.items():
+                if letter == "E":
+                    values = self.energy[idx] + np.cumsum(values)
+                    self.energy[idx] = float(values[-1])
+                else:
+                    values[missing] = np.nan
+                columns[f"{letter}_{n}"] = values
+            dt[missing | (dt == BIN_LATCH_OFFSET_STALE)] = np.nan
+            columns[f"dt_{n}"] = dt
+
+        columns["slow"] = frames[:, BIN_SLOW_POS].astype(float)
+        return make_samples(time_us / 1e6, columns)
+
+    def decode_summary_frame(self, frame: bytes | memoryview) -> np.ndarray:
+        """Unpack a binary summary `frame` as received from the Arduino when
+        decimating, see `decimate()`, into a single sample of `SAMPLE_DTYPE`.
+        """
+        seq = int.from_bytes(frame[2:6], "little")
+        if self.summary_seq is not None and seq != self.summary_seq + 1:
+            gap = (seq - self.summary_seq - 1) & 0xFFFFFFFF
+            self.bin_dropped_frames += gap
+        self.summary_seq = seq
+
+        time_us = int.from_bytes(frame[6:14], "little")  # [us]
+        count = int.from_bytes(frame[14:18], "little")
+        values = np.frombuffer(
+            frame,
+            dtype="<f4",
+            count=N_SENSORS * SUMMARY_VALUES_PER_SENSOR,
+            offset=BIN_SUMMARY_HEADER_LEN,
+        ).astype(float)
+
+        return self.summary_samples(time_us / 1e6, count, values)
+
+    # --------------------------------------------------------------------------
+    #   Scope mode
+    # --------------------------------------------------------------------------
+
+    def arm_scope(
+        self,
+        ch: str | None = None,
+        trig: str | None = None,
+        thr: float | None = None,
+        pre: int | None = None,
+        sensor: int | None = None,
+    ) -> bool:
+        """Turn DAQ off and capture a single channel `ch` of sensor index
+        `sensor` as fast as possible into the SRAM of the Arduino, around a
+        trigger event. `ch` is "I" for the current or "V" for the bus voltage,
+        and `trig` is "rise" or "fall" for a crossing of the threshold `thr`
+        or "step" for a change of at least `thr` between samples, in [mA] or
+        [mV]. `pre` is the number of samples to keep from before the trigger.
+        Omitted settings are left unchanged. Collect the capture with
+        `read_scope_capture()`.
+        """
+        cmd = "scope"
+        for key, val in (
+            ("ch", ch),
+            ("trig", trig),
+            ("thr", thr),
+            ("pre", pre),
+            ("s", sensor),
+        ):
+            if val is not None:
+                cmd += f" {key}={val}"
+        return self.write(cmd)
+
+    def abort_scope(self) -> bool:
+        return self.write("scope off")
+
+    def read_scope_capture(
+        self,
+    ) -> tuple[float, np.ndarray, np.ndarray] | None:
+        """Wait for the Arduino to trigger and receive the capture armed by
+        `arm_scope()`. This is blocking until the capture got received, or
+        until communication timed out while waiting for the next frame.
+
+        Returns the trigger timestamp [s], and the sample times [s] relative
+        to the trigger and the sample values [mA] or [mV] as arrays. Samples
+        of frames that failed the CRC check are NaN. Returns None when
+        communication timed out.
+        """
+        n_frames = None
+        times = values = None
+        n_received = 0
+
+        while n_frames is None or n_received < n_frames:
+            frame = self.read_binary_frame()
+            if frame is None:
+                return None
+            if frame == b"":
+                pft("Scope frame from the Arduino failed the CRC check.")
+                n_received += 1
+                continue
+            if frame[:2] != BIN_SYNC_SCOPE:
+                continue
+
+            index = int.from_bytes(frame[2:4], "little")
+            if n_frames is None:
+                n_frames = int.from_bytes(frame[4:6], "little")
+                n_samples = n_frames * BIN_SCOPE_SAMPLES
+                times = np.full(n_samples, np.nan)
+                values = np.full(n_samples, np.nan)
+                trig_time = int.from_bytes(frame[8:16], "little") / 1e6
+            samples = np.frombuffer(
+                frame,
+                dtype="<i4",
+                count=BIN_SCOPE_SAMPLES * 2,
+                offset=BIN_SCOPE_HEADER_LEN,
+            ).reshape(BIN_SCOPE_SAMPLES, 2)
+            p = index * BIN_SCOPE_SAMPLES
+            times[p : p + BIN_SCOPE_SAMPLES] = samples[:, 0] / 1e6
+            values[p : p + BIN_SCOPE_SAMPLES] = samples[:, 1] / 1e3
+            n_received += 1
+
+        return trig_time, times, values
+
     # --------------------------------------------------------------------------
     #   listen_to_Arduino
     # --------------------------------------------------------------------------
 
+    def read_chunk(self) -> bytes | None:
+        """Read all bytes received by the serial port so far, waiting up to
+        the read timeout for the first one.
+
+        Returns the bytes, or None when communication timed out.
+        """
+        if self.ser is None:
+            return None
+        try:
+            chunk = self.ser.read(max(1, self.ser.in_waiting))
+        except serial.SerialException:
+            return None
+        return chunk if chunk else None
+
+    def decode_chunk(self, chunk: bytes) -> np.ndarray:
+        """Decode all complete binary frames, or ASCII lines in text mode, in
+        the bytes received so far plus `chunk` into samples of `SAMPLE_DTYPE`.
+        The incomplete remainder waits for the next chunk.
+        """
+        data = self._rx + chunk
+        if self.binary_stream:
+            samples, consumed = self.decode_binary(data)
+            self._rx = data[consumed:]
+            return samples
+
+        lines = data.split(b"\n")
+        self._rx = lines.pop()
+        lines = [
+            line.decode("ascii", errors="replace").rstrip("\r")
+            for line in lines
+            if line.strip()
+        ]
+        samples = self.decode_text_lines(lines) if lines else None
+        return EMPTY_SAMPLES if samples is None else samples
+
     def listen_to_Arduino(self) -> int:
         """Listen to the Arduino for new readings being broadcast over the
         serial port. The Arduino must have received the `turn_on()` command
         in order for it to send out these readings.
 
         This method is blocking until we received enough data to fill up the
-        ring buffers with all new data, or until communication timed out.
+        ring buffers with all new data, or until communication timed out. The
+        serial port gets read in whole chunks that get decoded at once, see
+        `decode_chunk()`. Samples beyond the capacity of the ring buffers wait
+        for the next call.
 
         Returns the number of newly appended data rows.
         """
-
-        new_rows_count = 0
-        while True:
-            try:
-                _success, line = self.readline(raises_on_timeout=True)
-            except serial.SerialException:
+        capacity = self.state.capacity
+        while len(self._pending) < capacity:
+            chunk = self.read_chunk()
+            if chunk is None:
                 print("Communication timed out. ", end="")
-                if new_rows_count == 0:
+                if len(self._pending) == 0:
                     print("No new data was appended to the ring buffers.")
                 else:
                     print("New data was appended to the ring buffers.")
                 break
 
-            if not isinstance(line, str):
-                pft("Data received from the Arduino was not an ASCII string.")
-                break
-
-            if not self.parse_readings(line):
-                break
-
-            new_rows_count += 1
-            if new_rows_count == self.state.capacity:
-                break
+            samples = self.decode_chunk(chunk)
+            if len(samples) > 0:
+                self._pending = np.concatenate((self._pending, samples))
 
-        return new_rows_count
+        samples = self._pending[:capacity]
+        self._pending = self._pending[capacity:]
+        self.store_samples(samples)
+        return len(samples)
@@ -0,0 +1,256 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""Provides class `WindFarmBinaryLog` to record the timeseries of the wind farm
+into a compressed, columnar binary log file, written from a background thread
+so that the acquisition never waits on the disk or the compressor. Such a log
+takes a fraction of the size of a text log and loads much faster, see
+`WindFarmData.py` in `data_analysis`.
+
+File layout, all little-endian:
+
+    b"WFBL", uint16 version, uint32 header length, header as UTF-8 JSON
+    chunk, chunk, ...
+
+The header describes the data columns by name and unit, the compression codec
+and whatever else gets passed on, like the calibration of the sensors. Each
+chunk holds a block of rows, stored column after column:
+
+    b"WFCK", uint32 number of rows, uint32 payload length, payload
+
+The payload is the compressed concatenation of the columns, each as float64.
+Chunks get flushed to disk as soon as they fill up, so that a recording cut
+short by a crash only loses its last chunk.
+
+The layout and codecs are mirrored by `read_binary_file()` of
+`data_analysis/WindFarmData.py`, which reads these logs without depending on
+the control program. Change both together.
+"""
+__author__ = "Dennis van Gils"
+__authoremail__ = "vangils.dennis@gmail.com"
+__url__ = "https://github.com/Dennis-van-Gils/project-windfarm-practicum"
+__date__ = "14-10-2026"
+__version__ = "2.0"
+
+import datetime
+import json
+import queue
+import struct
+import threading
+import zlib
+from pathlib import Path
+
+import numpy as np
+
+try:
+    import zstandard
+except ImportError:
+    zstandard = None
+
+try:
+    import lz4.frame
+except ImportError:
+    lz4 = None
+
+# File layout, must match `BIN_*` in `data_analysis/WindFarmData.py`
+FILE_MAGIC = b"WFBL"
+FILE_VERSION = 1
+CHUNK_MAGIC = b"WFCK"
+FILE_HEADER = struct.Struct("<4sHI")
+CHUNK_HEADER = struct.Struct("<4sII")
+
+# Codecs in order of preference when none is asked for. "zlib" always works,
+# "zstd" and "lz4" need the `zstandard` and `lz4` packages. Must match
+# `BIN_CODECS` in `data_analysis/WindFarmData.py`.
+CODECS = ("zstd", "lz4", "zlib", "none")
+CODEC_PACKAGES = {"zstd": "zstandard", "lz4": "lz4"}
+
+
+def available_codecs() -> list[str]:
+    return [
+        codec
+        for codec in CODECS
+        if (codec != "zstd" or zstandard is not None)
+        and (codec != "lz4" or lz4 is not None)
+    ]
+
+
+def compress(data: bytes, codec: str) -> bytes:
+    if codec == "zstd":
+        return zstandard.ZstdCompressor(level=3).compress(data)
+    if codec == "lz4":
+        return lz4.frame.compress(data)
+    if codec == "zlib":
+        return zlib.compress(data, 6)
+    return data
+
+
+def decompress(data: bytes | memoryview, codec: str) -> bytes | memoryview:
+    if codec == "zstd":
+        return zstandard.ZstdDecompressor().decompress(data)
+    if codec == "lz4":
+        return lz4.frame.decompress(data)
+    if codec == "zlib":
+        return zlib.decompress(data)
+    return data
+
+
+class WindFarmBinaryLog:
+    """Records rows of a fixed set of columns into a binary log file, see the
+    module docstring for the layout.
+
+    Args:
+        filepath (`pathlib.Path` | `str`):
+            Path of the log file, gets overwritten.
+
+        fields (`list[str]`):
+            Names of the columns.
+
+        units (`list[str]`):
+            Units of the columns.
+
+        metadata (`dict`, optional):
+            Anything else to store in the header, e.g. the calibration of the
+            sensors. Must be JSON serializable.
+
+        codec (`str`, optional):
+            Compression codec, one of `CODECS`. Defaults to the first one of
+            `available_codecs()`.
+
+        chunk_rows (`int`, optional):
+            Number of rows per chunk.
+    """
+
+    def __init__(
+        self,
+        filepath: Path | str,
+        fields: list[str],
+        units: list[str],
+        metadata: dict | None = None,
+        codec: str | None = None,
+        chunk_rows: int = 4096,
+    ):
+        if codec is None:
+            codec = available_codecs()[0]
+        if codec not in available_codecs():
+            raise ValueError(f"Compression codec not available: {codec}")
+
+        self.filepath = Path(filepath)
+        self.fields = list(fields)
+        self.codec = codec
+        self.chunk_rows = chunk_rows
+
+        header = {
+            "version": FILE_VERSION,
+            "codec": codec,
+            "fields": self.fields,
+            "units": list(units),
+            "created": datetime.datetime.now().isoformat(timespec="seconds"),
+            **(metadata or {}),
+        }
+        header = json.dumps(header).encode("utf-8")
+
+        self._file = self.filepath.open("wb")
+        self._file.write(
+            FILE_HEADER.pack(FILE_MAGIC, FILE_VERSION, len(header))
+        )
+        self._file.write(header)
+        self._file.flush()
+
+        self._queue = queue.Queue()
+        self._thread = threading.Thread(
+            target=self._run, name="BINARY_LOG", daemon=True
+        )
+        self._thread.start()
+
+    def append(self, columns: list):
+        """Append rows, passed as one array-like per column in the order of
+        `fields`. The data gets copied, so the arrays may be reused right
+        after. Returns right away, the writing happens in the background.
+        """
+        block = np.array(columns, dtype="<f8")
+        if block.ndim == 1:
+            block = block[:, np.newaxis]  # A single row of scalars
+        if block.shape[0] != len(self.fields):
+            raise ValueError("Wrong number of columns for the binary log.")
+        self._queue.put(block)
+
+    def close(self):
+        """Write out the remaining rows and close the file. Blocks until the
+        background thread is done.
+        """
+        if self._thread.is_alive():
+            self._queue.put(None)
+            self._thread.join()
+
+    def _run(self):
+        pending = []
+        n_pending = 0
+        while True:
+            block = self._queue.get()
+            if block is not None:
+                pending.append(block)
+                n_pending += block.shape[1]
+            while n_pending >= self.chunk_rows or (
+                block is None and n_pending > 0
+            ):
+                rows = np.concatenate(pending, axis=1)
+                self._write_chunk(rows[:, : self.chunk_rows])
+                pending = [rows[:, self.chunk_rows :]]
+                n_pending = pending[0].shape[1]
+            if block is None:
+                self._file.close()
+                return
+
+    def _write_chunk(self, rows: np.ndarray):
+        # Column after column, as the rows are stored as columns
+        payload = compress(np.ascontiguousarray(rows).tobytes(), self.codec)
+        self._file.write(
+            CHUNK_HEADER.pack(CHUNK_MAGIC, rows.shape[1], len(payload))
+        )
+        self._file.write(payload)
+        self._file.flush()
+
+
+def read_binary_log(filepath: Path | str) -> tuple[dict, dict]:
+    """Read a binary log file as written by `WindFarmBinaryLog`.
+
+    Returns the header, and a dict mapping the column names onto arrays. An
+    incomplete last chunk gets ignored.
+    """
+    with open(filepath, "rb") as f:
+        data = f.read()
+
+    magic, _version, header_len = FILE_HEADER.unpack_from(data)
+    if magic != FILE_MAGIC:
+        raise TypeError("Not a Wind Farm binary log file.")
+    p = FILE_HEADER.size
+    header = json.loads(data[p : p + header_len].decode("utf-8"))
+    p += header_len
+
+    codec = header["codec"]
+    if codec not in CODECS:
+        raise ValueError(f"Unknown compression codec: {codec}")
+    if codec not in available_codecs():
+        raise ImportError(
+            f"Reading a binary log compressed with {codec} needs the package "
+            f"`{CODEC_PACKAGES[codec]}`."
+        )
+
+    n_fields = len(header["fields"])
+    chunks = []
+    while p + CHUNK_HEADER.size <= len(data):
+        magic, n_rows, payload_len = CHUNK_HEADER.unpack_from(data, p)
+        p += CHUNK_HEADER.size
+        if magic != CHUNK_MAGIC or p + payload_len > len(data):
+            break
+        payload = decompress(data[p : p + payload_len], codec)
+        chunks.append(
+            np.frombuffer(payload, dtype="<f8").reshape(n_fields, n_rows)
+        )
+        p += payload_len
+
+    if chunks:
+        values = np.concatenate(chunks, axis=1)
+    else:
+        values = np.empty((n_fields, 0))
+    return header, dict(zip(header["fields"], values))
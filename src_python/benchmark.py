@@ -0,0 +1,317 @@
+#!/usr/bin/env python3
+# -*- coding: utf-8 -*-
+"""Benchmark of the sustained sample rate of an Arduino programmed as a wind
+farm. Sweeps a set of ADC configurations and channel selections, streams for
+a while at each and reports the throughput, the samples lost on the way, the
+jitter of the timestamps and the round-trip latency of the serial link. The
+firmware can also generate samples by itself at a fixed rate, see
+`WindFarmArduino.set_benchmark()`, to measure the serial link without the
+sensors.
+
+The results can be saved as a CSV file with `--csv` and compared against such
+a baseline with `--baseline`, to check a change to the firmware for
+regressions:
+
+    python benchmark.py --csv before.csv
+    (upload the changed firmware)
+    python benchmark.py --baseline before.csv
+"""
+__author__ = "Dennis van Gils"
+__authoremail__ = "vangils.dennis@gmail.com"
+__url__ = "https://github.com/Dennis-van-Gils/project-windfarm-practicum"
+__date__ = "14-10-2026"
+__version__ = "2.0"
+# pylint: disable=missing-function-docstring
+
+import argparse
+import csv
+import math
+import statistics
+import sys
+import time
+
+from WindFarmArduino import WindFarmArduino
+
+# Configurations to sweep: name, ADC settings as passed to `configure()`,
+# channels as passed to `set_channels()` and the rate [Hz] of the samples
+# generated by the firmware itself, or None to read out the sensors
+CONFIGS = (
+    ("ct50", dict(ct=50, vt=50, tt=50, avg=1), "I,V,E", None),
+    ("ct50_I", dict(ct=50, vt=50, tt=50, avg=1), "I", None),
+    ("ct50_all", dict(ct=50, vt=50, tt=50, avg=1), "I,V,E,P,T", None),
+    ("ct280", dict(ct=280, vt=280, tt=280, avg=1), "I,V,E", None),
+    ("ct1052", dict(ct=1052, vt=1052, tt=1052, avg=1), "I,V,E", None),
+    ("ct1052_avg16", dict(ct=1052, vt=1052, tt=1052, avg=16), "I,V,E", None),
+    ("bench1k", None, "I,V,E", 1000),
+    ("bench5k", None, "I,V,E", 5000),
+    ("bench_max", None, "I,V,E", 0),
+    ("bench_max_all", None, "I,V,E,P,T", 0),
+)
+
+# Columns of the results, in the order of the CSV file
+COLUMNS = (
+    "name",
+    "mode",
+    "transport",
+    "rows",
+    "rows_per_s",
+    "seq_gaps",
+    "crc_errors",
+    "ring_dropped",
+    "ring_max_fill",
+    "period_us",
+    "jitter_us",
+    "max_interval_us",
+    "late_intervals",
+    "rtt_median_ms",
+    "rtt_max_ms",
+    "send_mean_us",
+    "send_max_us",
+    "sweep_mean_us",
+    "sweep_max_us",
+    "link_bytes_per_s",
+    "link_bytes_per_write",
+)
+
+# Number of `t?` queries to measure the round-trip latency with
+N_LATENCY_QUERIES = 50
+
+# [s] Streaming of real samples ahead of a configuration generated by the
+# firmware, see `prime_sweep()`
+PRIME_DURATION = 0.2
+
+
+# ------------------------------------------------------------------------------
+#   Measurements
+# ------------------------------------------------------------------------------
+
+
+def measure_latency(ard: WindFarmArduino) -> tuple[float, float]:
+    """Median and maximum round-trip time [ms] of a query while DAQ is off"""
+    rtt = []
+    for _ in range(N_LATENCY_QUERIES):
+        t0 = time.perf_counter()
+        if ard.query_time() is None:
+            continue
+        rtt.append((time.perf_counter() - t0) * 1e3)
+    if not rtt:
+        return math.nan, math.nan
+    return statistics.median(rtt), max(rtt)
+
+
+def discard_rows(ard: WindFarmArduino):
+    """Let the rows still underway after DAQ got turned off arrive and
+    discard them
+    """
+    time.sleep(0.2)
+    if ard.ser is not None:
+        ard.ser.reset_input_buffer()
+
+
+def prime_sweep(ard: WindFarmArduino):
+    """Stream real samples for a moment, so that the samples generated by the
+    firmware repeat the results of every sensor that is up with the selected
+    channels, whichever configuration ran before, or none at all.
+    """
+    ard.set_benchmark(None)
+    ard.turn_on()
+    time.sleep(PRIME_DURATION)
+    ard.turn_off()
+    discard_rows(ard)
+
+
+def stream(
+    ard: WindFarmArduino, duration: float
+) -> tuple[int, list[int], float]:
+    """Turn DAQ on for `duration` [s] and collect the timestamps [us] of the
+    rows. Binary frames get read in whole chunks and decoded at once, the
+    same way as `listen_to_Arduino()` does, and the gaps in their sequence
+    counters get counted. Text rows carry no sequence counter, only their
+    timestamps get parsed. Returns the number of frames missing from the
+    gaps, the timestamps and the elapsed wall-clock time [s].
+    """
+    stamps = []
+    ard.turn_on()
+    dropped = ard.bin_dropped_frames
+    t0 = time.perf_counter()
+    while time.perf_counter() - t0 < duration:
+        if ard.binary_stream:
+            chunk = ard.read_chunk()
+            if chunk is None:
+                break
+            # Corrupted frames get counted by `decode_binary()`
+            samples = ard.decode_chunk(chunk)
+            stamps.extend(round(t * 1e6) for t in samples["time"].tolist())
+        else:
+            success, line = ard.readline()
+            if not success or not isinstance(line, str):
+                break
+            if line.startswith("#"):
+                continue
+            try:
+                stamps.append(round(float(line.split("\t", 1)[0]) * 1e6))
+            except ValueError:
+                ard.bin_crc_errors += 1
+    elapsed = time.perf_counter() - t0
+    seq_gaps = ard.bin_dropped_frames - dropped
+    ard.turn_off()
+    discard_rows(ard)
+    return seq_gaps, stamps, elapsed
+
+
+def run_config(
+    ard: WindFarmArduino,
+    name: str,
+    adc: dict | None,
+    channels: str,
+    rate: int | None,
+    duration: float,
+) -> dict:
+    """Stream a single configuration and return its row of results"""
+    ard.decimate()
+    ard.set_channels(channels)
+    if rate is not None:
+        prime_sweep(ard)
+    ard.set_benchmark(rate)
+    if adc is not None:
+        ard.configure(**adc)
+    rtt_median, rtt_max = measure_latency(ard)
+
+    ard.reset_stats()
+    crc_errors = ard.bin_crc_errors
+    seq_gaps, stamps, elapsed = stream(ard, duration)
+    crc_errors = ard.bin_crc_errors - crc_errors
+    ring = ard.query_ring() or [0] * 5
+    link = ard.query_link() or {}
+    stats = ard.query_stats() or {}
+    ard.set_benchmark(None)
+
+    # Gaps in the sequence counter are samples lost on the way, either in the
+    # ring buffer of the Arduino or by corruption. Intervals well beyond the
+    # typical one are ticks missed by the Arduino.
+    intervals = [b - a for a, b in zip(stamps, stamps[1:])] or [math.nan]
+    period = statistics.median(intervals)
+    late = sum(dt > 1.5 * period for dt in intervals)
+
+    return {
+        "name": name,
+        "mode": "bin" if ard.binary_stream else "txt",
+        "transport": ard.transport,
+        "rows": len(stamps),
+        "rows_per_s": len(stamps) / elapsed,
+        "seq_gaps": seq_gaps,
+        "crc_errors": crc_errors,
+        "ring_dropped": ring[3],
+        "ring_max_fill": ring[1],
+        "period_us": period,
+        "jitter_us": statistics.pstdev(intervals),
+        "max_interval_us": max(intervals),
+        "late_intervals": late,
+        "rtt_median_ms": rtt_median,
+        "rtt_max_ms": rtt_max,
+        "send_mean_us": stats.get("send", [0, 0, 0])[1],
+        "send_max_us": stats.get("send", [0, 0, 0])[2],
+        "sweep_mean_us": stats.get("sweep", [0, 0, 0])[1],
+        "sweep_max_us": stats.get("sweep", [0, 0, 0])[2],
+        "link_bytes_per_s": link.get("bytes_per_s", 0),
+        "link_bytes_per_write": link.get("bytes_per_write", 0),
+    }
+
+
+# ------------------------------------------------------------------------------
+#   Reporting
+# ------------------------------------------------------------------------------
+
+
+def print_result(result: dict, baseline: dict | None):
+    line = (
+        f"{result['name']:14s} {result['mode']}  "
+        f"{result['rows_per_s']:8.1f} rows/s  "
+        f"gaps {result['seq_gaps']:5d}  "
+        f"ring {result['ring_dropped']:5d}  "
+        f"link {result['link_bytes_per_s'] / 1e3:7.1f} kB/s  "
+        f"crc {result['crc_errors']:3d}  "
+        f"jitter {result['jitter_us']:7.1f} us  "
+        f"max {result['max_interval_us']:8.0f} us  "
+        f"rtt {result['rtt_median_ms']:5.2f}/{result['rtt_max_ms']:5.2f} ms"
+    )
+    if baseline is not None:
+        ref = float(baseline["rows_per_s"])
+        if ref > 0:
+            line += f"  ({result['rows_per_s'] / ref - 1:+.1%} vs baseline)"
+    print(line)
+
+
+def read_baseline(path: str) -> dict[tuple[str, str], dict]:
+    with open(path, newline="", encoding="utf-8") as f:
+        return {(row["name"], row["mode"]): row for row in csv.DictReader(f)}
+
+
+def write_results(path: str, results: list[dict]):
+    with open(path, "w", newline="", encoding="utf-8") as f:
+        writer = csv.DictWriter(f, fieldnames=COLUMNS)
+        writer.writeheader()
+        writer.writerows(results)
+
+
+# ------------------------------------------------------------------------------
+#   main
+# ------------------------------------------------------------------------------
+
+if __name__ == "__main__":
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument(
+        "-t",
+        "--duration",
+        type=float,
+        default=10,
+        help="time to stream each configuration [s], default 10",
+    )
+    parser.add_argument(
+        "--txt",
+        action="store_true",
+        help="stream ASCII rows instead of binary frames",
+    )
+    parser.add_argument(
+        "--only",
+        nargs="+",
+        metavar="NAME",
+        help="run only the named configurations",
+    )
+    parser.add_argument("--csv", help="save the results to this CSV file")
+    parser.add_argument(
+        "--baseline", help="compare against the results in this CSV file"
+    )
+    args = parser.parse_args()
+
+    baselines = read_baseline(args.baseline) if args.baseline else {}
+
+    ard = WindFarmArduino(binary_stream=not args.txt)
+    ard.auto_connect()
+    if not ard.is_alive:
+        print("\nCheck connection and try resetting the Arduino.")
+        print("Exiting...\n")
+        sys.exit(0)
+
+    ard.turn_off()
+    time.sleep(0.2)
+    if ard.ser is not None:
+        ard.ser.reset_input_buffer()
+    health = ard.query_health()
+    if health is not None and not all(up for up, _errors in health):
+        print("Warning: Not all sensors are up, see `health?`.\n")
+
+    results = []
+    try:
+        for name, adc, channels, rate in CONFIGS:
+            if args.only and name not in args.only:
+                continue
+            result = run_config(ard, name, adc, channels, rate, args.duration)
+            print_result(result, baselines.get((name, result["mode"])))
+            results.append(result)
+    finally:
+        ard.set_benchmark(None)
+        ard.close()
+
+    if args.csv:
+        write_results(args.csv, results)
@@ -14,6 +14,8 @@ __version__ = "2.0"
 
 import os
 import sys
+import threading
+from pathlib import Path
 
 import qtpy
 from qtpy import QtCore, QtGui, QtWidgets as QtWid
@@ -34,7 +36,8 @@ from dvg_pyqtgraph_threadsafe import (
 from dvg_pyqt_filelogger import FileLogger
 import dvg_pyqt_controls as controls
 
-from WindFarmArduino import WindFarmArduino
+from WindFarmArduino import WindFarmArduino, SAMPLE_DTYPE
+from WindFarmBinaryLog import WindFarmBinaryLog, read_binary_log
 from WindFarm_qdev import WindFarm_qdev
 
 # Constants
@@ -44,6 +47,10 @@ CHART_CAPACITY = int(1e4)  # [number of points]
 TRY_USING_OPENGL = True
 USE_LARGER_TEXT = False
 
+# Record to a compressed binary log file while DAQ is running, and only export
+# it to the text log once recording stops? See `WindFarmBinaryLog.py`.
+LOG_BINARY = True
+
 # Show debug info in terminal? Warning: Slow! Do not leave on unintentionally.
 DEBUG = False
 
@@ -564,8 +571,10 @@ if __name__ == "__main__":
     #   Connect to Arduino
     # --------------------------------------------------------------------------
 
-    ard = WindFarmArduino(ring_buffer_capacity=15)
+    ard = WindFarmArduino(ring_buffer_capacity=15, binary_stream=True)
     ard.auto_connect()
+    calibration = ard.query_calibration()
+    ard.set_channels("I,V,E,P")  # Power as computed by the INA228
     ard.turn_on()
 
     if not ard.is_alive:
@@ -594,6 +603,7 @@ if __name__ == "__main__":
     # --------------------------------------------------------------------------
 
     def DAQ_function() -> bool:
+        global log_filepath  # pylint: disable=global-statement
         new_rows_count = ard.listen_to_Arduino()
 
         if new_rows_count != ard.state.capacity:
@@ -613,8 +623,12 @@ if __name__ == "__main__":
         window.tscurves_E[4].extendData(ard.state.time, ard.state.E_5)
         window.tscurves_E[5].extendData(ard.state.time, ard.state.E_6)
 
-        # Add readings to the log
-        log.update()
+        # Add readings to the log. The file name gets chosen here, so that the
+        # binary log can share it.
+        if not log.is_recording():
+            cur_date_time = QtCore.QDateTime.currentDateTime()
+            log_filepath = f"{cur_date_time.toString('yyMMdd_HHmmss')}.txt"
+        log.update(filepath=log_filepath)
 
         # Work-around for the jobs thread not getting fairly granted a mutex
         # lock on the device mutex `dev.mutex`. It can sometimes wait multiple
@@ -636,6 +650,28 @@ if __name__ == "__main__":
     #   File logger
     # --------------------------------------------------------------------------
 
+    # Columns of the text log, in order
+    TEXT_LOG_FIELDS = ("time",) + tuple(
+        f"{x}_{n}" for n in range(1, 7) for x in ("P", "E")
+    )
+    TEXT_LOG_FMT = "\t".join(["%.4f"] * len(TEXT_LOG_FIELDS))
+
+    # Units of the quantities in the binary log
+    BINARY_LOG_UNITS = {
+        "time": "s",
+        "I": "mA",
+        "V": "mV",
+        "E": "J",
+        "P": "mW",
+        "T": "'C",
+        "Q": "C",
+        "dt": "us",
+        "slow": "",
+    }
+
+    log_filepath = ""
+    bin_log: WindFarmBinaryLog | None = None
+
     def write_header_to_log():
         log.write(
             "time [s]\t"
@@ -646,30 +682,55 @@ if __name__ == "__main__":
             "P_5 [mW]\tE_5 [J]\t"
             "P_6 [mW]\tE_6 [J]\n"
         )
+        if LOG_BINARY:
+            start_binary_log()
 
     def write_data_to_log():
-        np_data = np.column_stack(
-            (
-                ard.state.time,
-                ard.state.P_1,
-                ard.state.E_1,
-                ard.state.P_2,
-                ard.state.E_2,
-                ard.state.P_3,
-                ard.state.E_3,
-                ard.state.P_4,
-                ard.state.E_4,
-                ard.state.P_5,
-                ard.state.E_5,
-                ard.state.P_6,
-                ard.state.E_6,
+        if bin_log is not None:
+            bin_log.append(
+                [getattr(ard.state, name) for name in SAMPLE_DTYPE.names]
             )
-        )
-        log.np_savetxt(
-            np_data,
-            "%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t"
-            "%.4f\t%.4f\t%.4f\t%.4f\t%.4f\t%.4f",
-        )
+            return
+
+        np_data = np.column_stack(
+            [getattr(ard.state, name) for name in TEXT_LOG_FIELDS]
+        )
+        log.np_savetxt(np_data, TEXT_LOG_FMT)
+
+    def start_binary_log():
+        """Record all quantities of the `state` ring buffers into a binary log
+        next to the text log, which only gets the header until recording
+        stops."""
+        global bin_log  # pylint: disable=global-statement
+        finish_binary_log()  # Of a previous recording, when still pending
+        bin_log = WindFarmBinaryLog(
+            Path(log_filepath).with_suffix(".wfbl"),
+            fields=SAMPLE_DTYPE.names,
+            units=[
+                BINARY_LOG_UNITS[name.split("_")[0]]
+                for name in SAMPLE_DTYPE.names
+            ],
+            metadata={"calibration": calibration},
+        )
+
+    def finish_binary_log():
+        """Close the binary log, when recording, and append its rows to the
+        text log from a background thread."""
+        global bin_log  # pylint: disable=global-statement
+        if bin_log is None:
+            return
+        done, bin_log = bin_log, None
+        done.close()
+        threading.Thread(
+            target=export_binary_log, args=(done.filepath,), name="LOG_EXPORT"
+        ).start()
+
+    def export_binary_log(filepath: Path):
+        _header, data = read_binary_log(filepath)
+        np_data = np.column_stack([data[name] for name in TEXT_LOG_FIELDS])
+        with filepath.with_suffix(".txt").open("a", encoding="utf-8") as f:
+            np.savetxt(f, np_data, fmt=TEXT_LOG_FMT)
+        print(f"Exported {filepath.name} to text.")
 
     log = FileLogger(
         write_header_function=write_header_to_log,
@@ -683,6 +744,7 @@ if __name__ == "__main__":
     log.signal_recording_stopped.connect(
         lambda: window.qpbt_record.setText("Click to start recording to file")
     )
+    log.signal_recording_stopped.connect(lambda: finish_binary_log())
 
     # --------------------------------------------------------------------------
     #   Program termination routines
@@ -709,6 +771,7 @@ if __name__ == "__main__":
     def stop_running():
         app.processEvents()
         log.close()
+        finish_binary_log()
         ard_qdev.quit()
         ard.turn_off()
         ard.close()